@@ -0,0 +1,547 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "carrier.h"
+#include "types.h"
+
+// Bytes copied per fread/fwrite when passing non-pixel data through
+#define CARRIER_COPY_SIZE 4096
+
+// TIFF tags and field types used by the parser
+#define TIFF_IMAGE_WIDTH 256
+#define TIFF_IMAGE_LENGTH 257
+#define TIFF_BITS_PER_SAMPLE 258
+#define TIFF_COMPRESSION 259
+#define TIFF_PHOTOMETRIC 262
+#define TIFF_STRIP_OFFSETS 273
+#define TIFF_SAMPLES_PER_PIXEL 277
+#define TIFF_STRIP_BYTE_COUNTS 279
+#define TIFF_SHORT 3
+#define TIFF_LONG 4
+#define TIFF_PHOTOMETRIC_PALETTE 3
+
+// Function to read n little- or big-endian bytes as an unsigned value
+static uint read_uint(FILE *fptr, int n, int big_endian, Status *status)
+{
+    uchar bytes[4];
+    uint value = 0;
+
+    if (fread(bytes, n, 1, fptr) != 1)
+    {
+        *status = e_failure;
+        return 0;
+    }
+    for (int i = 0; i < n; i++)
+        value |= (uint)bytes[big_endian ? i : n - 1 - i] << (8 * (n - 1 - i));
+    return value;
+}
+
+// Function to get the file size without moving the file pointer
+static long carrier_file_size(FILE *fptr)
+{
+    long pos = ftell(fptr);
+    fseek(fptr, 0, SEEK_END);
+    long size = ftell(fptr);
+    fseek(fptr, pos, SEEK_SET);
+    return size;
+}
+
+// Function to describe row spans of formats that store rows back to back
+static Status get_row_span(const Carrier *carrier, long index, long *offset, long *size)
+{
+    if (index >= carrier->height)
+        return e_failure;
+    *offset = carrier->data_offset + index * carrier->row_stride;
+    *size = carrier->row_size;
+    return e_success;
+}
+
+// Function to parse a BMP header (uncompressed 24 or 32 bits per pixel)
+static Status parse_bmp_header(Carrier *carrier)
+{
+    Status status = e_success;
+    FILE *fptr = carrier->fptr;
+    char magic[2];
+
+    rewind(fptr);
+    if (fread(magic, 2, 1, fptr) != 1 || magic[0] != 'B' || magic[1] != 'M')
+    {
+        printf("ERROR: Not a BMP file\n");
+        return e_failure;
+    }
+
+    // Pixel data offset is at byte 10, width at 18, height at 22
+    fseek(fptr, 10, SEEK_SET);
+    carrier->data_offset = read_uint(fptr, 4, 0, &status);
+    fseek(fptr, 18, SEEK_SET);
+    int width = read_uint(fptr, 4, 0, &status);
+    int height = read_uint(fptr, 4, 0, &status);
+    read_uint(fptr, 2, 0, &status);  // Planes
+    uint bits = read_uint(fptr, 2, 0, &status);
+    uint compression = read_uint(fptr, 4, 0, &status);
+
+    if (status == e_failure || width <= 0 || height == 0)
+    {
+        printf("ERROR: Truncated or invalid BMP header\n");
+        return e_failure;
+    }
+    if ((bits != 24 && bits != 32) || compression != 0)
+    {
+        printf("ERROR: Only uncompressed 24 or 32-bit BMP images are supported\n");
+        return e_failure;
+    }
+
+    // Rows are padded to 4 bytes; the padding is used too, as it always has been
+    carrier->width = width;
+    carrier->height = height < 0 ? -height : height;
+    carrier->channels = bits / 8;
+    carrier->row_stride = (((long)width * bits + 31) / 32) * 4;
+    carrier->row_size = carrier->row_stride;
+
+    // Pixel data must follow the 54-byte headers and fit in the file
+    if (carrier->data_offset < 54)
+    {
+        printf("ERROR: Invalid BMP pixel data offset\n");
+        return e_failure;
+    }
+    if (carrier->data_offset + carrier->row_stride * carrier->height > carrier_file_size(fptr))
+    {
+        printf("ERROR: BMP pixel data is truncated\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+// Function to read the next number from a PPM/PGM header, skipping comments
+static long read_pnm_number(FILE *fptr)
+{
+    int ch = fgetc(fptr);
+    long value = 0;
+
+    while (ch == '#' || ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+    {
+        if (ch == '#')
+            while (ch != '\n' && ch != EOF)
+                ch = fgetc(fptr);
+        ch = fgetc(fptr);
+    }
+    if (ch < '0' || ch > '9')
+        return -1;
+
+    while (ch >= '0' && ch <= '9')
+    {
+        value = value * 10 + (ch - '0');
+        ch = fgetc(fptr);
+    }
+    // The single whitespace after the last number ends the header
+    if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n')
+        return -1;
+    return value;
+}
+
+// Function to parse a binary PPM (P6) or PGM (P5) header
+static Status parse_pnm_header(Carrier *carrier)
+{
+    FILE *fptr = carrier->fptr;
+    char magic[2];
+
+    rewind(fptr);
+    if (fread(magic, 2, 1, fptr) != 1 || magic[0] != 'P' || (magic[1] != '6' && magic[1] != '5'))
+    {
+        printf("ERROR: Only binary PPM (P6) and PGM (P5) files are supported\n");
+        return e_failure;
+    }
+
+    long width = read_pnm_number(fptr);
+    long height = read_pnm_number(fptr);
+    long maxval = read_pnm_number(fptr);
+    if (width <= 0 || height <= 0 || maxval <= 0)
+    {
+        printf("ERROR: Truncated or invalid PPM/PGM header\n");
+        return e_failure;
+    }
+    // With a smaller maxval, setting an LSB could push a sample past maxval
+    if (maxval != 255)
+    {
+        printf("ERROR: Only 8-bit PPM/PGM files with maxval 255 are supported\n");
+        return e_failure;
+    }
+
+    carrier->width = width;
+    carrier->height = height;
+    carrier->channels = magic[1] == '6' ? 3 : 1;
+    carrier->data_offset = ftell(fptr);
+    carrier->row_size = width * carrier->channels;
+    carrier->row_stride = carrier->row_size;
+
+    if (carrier->data_offset + carrier->row_size * height > carrier_file_size(fptr))
+    {
+        printf("ERROR: PPM/PGM pixel data is truncated\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+// Function to check raw RGB geometry against the file size
+static Status parse_raw_header(Carrier *carrier)
+{
+    if (carrier->width == 0 || carrier->height == 0)
+    {
+        printf("ERROR: Raw RGB files need --geometry <width>x<height>\n");
+        return e_failure;
+    }
+
+    carrier->channels = 3;
+    carrier->data_offset = 0;
+    carrier->row_size = (long)carrier->width * 3;
+    carrier->row_stride = carrier->row_size;
+
+    if (carrier->row_size * carrier->height > carrier_file_size(carrier->fptr))
+    {
+        printf("ERROR: Raw RGB file is smaller than %ux%u pixels\n", carrier->width, carrier->height);
+        return e_failure;
+    }
+    return e_success;
+}
+
+// Function to read a TIFF SHORT or LONG array, inline or at an offset
+static Status read_tiff_values(Carrier *carrier, uint type, uint count, long field_pos, long *values)
+{
+    Status status = e_success;
+    int size = type == TIFF_SHORT ? 2 : 4;
+
+    if (type != TIFF_SHORT && type != TIFF_LONG)
+        return e_failure;
+
+    fseek(carrier->fptr, field_pos, SEEK_SET);
+    if (count * size > 4)
+        fseek(carrier->fptr, read_uint(carrier->fptr, 4, carrier->big_endian, &status), SEEK_SET);
+    for (uint i = 0; i < count && status == e_success; i++)
+        values[i] = read_uint(carrier->fptr, size, carrier->big_endian, &status);
+    return status;
+}
+
+// Function to parse the first IFD of an uncompressed 8-bit TIFF
+static Status parse_tiff_header(Carrier *carrier)
+{
+    Status status = e_success;
+    FILE *fptr = carrier->fptr;
+    char order[2];
+    long bits = 8, compression = 1, spp = 1, width = 0, height = 0, photometric = 1;
+    long nsizes = 0;
+
+    rewind(fptr);
+    if (fread(order, 2, 1, fptr) != 1 || order[0] != order[1] || (order[0] != 'I' && order[0] != 'M'))
+    {
+        printf("ERROR: Not a TIFF file\n");
+        return e_failure;
+    }
+    carrier->big_endian = order[0] == 'M';
+    if (read_uint(fptr, 2, carrier->big_endian, &status) != 42)
+    {
+        printf("ERROR: Not a TIFF file\n");
+        return e_failure;
+    }
+
+    long ifd = read_uint(fptr, 4, carrier->big_endian, &status);
+    fseek(fptr, ifd, SEEK_SET);
+    uint entries = read_uint(fptr, 2, carrier->big_endian, &status);
+
+    for (uint i = 0; i < entries && status == e_success; i++)
+    {
+        long field_pos = ifd + 2 + 12 * i + 8;
+        fseek(fptr, ifd + 2 + 12 * i, SEEK_SET);
+        uint tag = read_uint(fptr, 2, carrier->big_endian, &status);
+        uint type = read_uint(fptr, 2, carrier->big_endian, &status);
+        uint count = read_uint(fptr, 4, carrier->big_endian, &status);
+        if (status == e_failure)
+            break;
+
+        if (tag == TIFF_STRIP_OFFSETS || tag == TIFF_STRIP_BYTE_COUNTS)
+        {
+            long *values = malloc(sizeof(long) * (count ? count : 1));
+            if (values == NULL || read_tiff_values(carrier, type, count, field_pos, values) == e_failure)
+            {
+                free(values);
+                status = e_failure;
+                break;
+            }
+            if (tag == TIFF_STRIP_OFFSETS)
+            {
+                free(carrier->strip_offsets);
+                carrier->strip_offsets = values;
+                carrier->nstrips = count;
+            }
+            else
+            {
+                free(carrier->strip_sizes);
+                carrier->strip_sizes = values;
+                nsizes = count;
+            }
+        }
+        else if (tag == TIFF_BITS_PER_SAMPLE)
+        {
+            // Every sample must be 8 bits; only the first few are checked
+            long values[4];
+            if (read_tiff_values(carrier, type, count < 4 ? count : 4, field_pos, values) == e_failure)
+            {
+                status = e_failure;
+                break;
+            }
+            for (uint j = 0; j < count && j < 4; j++)
+                if (values[j] != 8)
+                    bits = values[j];
+        }
+        else if (tag == TIFF_IMAGE_WIDTH || tag == TIFF_IMAGE_LENGTH ||
+                 tag == TIFF_COMPRESSION || tag == TIFF_PHOTOMETRIC || tag == TIFF_SAMPLES_PER_PIXEL)
+        {
+            long value;
+            if (read_tiff_values(carrier, type, 1, field_pos, &value) == e_failure)
+                status = e_failure;
+            else if (tag == TIFF_IMAGE_WIDTH)
+                width = value;
+            else if (tag == TIFF_IMAGE_LENGTH)
+                height = value;
+            else if (tag == TIFF_COMPRESSION)
+                compression = value;
+            else if (tag == TIFF_PHOTOMETRIC)
+                photometric = value;
+            else
+                spp = value;
+        }
+    }
+
+    if (status == e_failure || width <= 0 || height <= 0 || carrier->nstrips == 0 ||
+        nsizes != carrier->nstrips)
+    {
+        printf("ERROR: Truncated or invalid TIFF header\n");
+        return e_failure;
+    }
+    if (compression != 1 || bits != 8)
+    {
+        printf("ERROR: Only uncompressed 8-bit TIFF images are supported\n");
+        return e_failure;
+    }
+    if (photometric == TIFF_PHOTOMETRIC_PALETTE)
+    {
+        // An LSB change in a palette index picks a different colour, not a close one
+        printf("ERROR: Palette TIFF images are not supported\n");
+        return e_failure;
+    }
+
+    // Strips are streamed in file order, so they must not go backwards or overlap,
+    // and must leave the 8-byte header and the IFD untouched
+    long file_size = carrier_file_size(fptr);
+    long ifd_end = ifd + 2 + 12L * entries + 4;
+    for (long i = 0; i < carrier->nstrips; i++)
+    {
+        long end = carrier->strip_offsets[i] + carrier->strip_sizes[i];
+        if (carrier->strip_offsets[i] < 8 || end > file_size ||
+            (carrier->strip_offsets[i] < ifd_end && end > ifd) ||
+            (i > 0 && carrier->strip_offsets[i] < carrier->strip_offsets[i - 1] + carrier->strip_sizes[i - 1]))
+        {
+            printf("ERROR: TIFF strips overlap the header, are out of order or truncated\n");
+            return e_failure;
+        }
+    }
+
+    carrier->width = width;
+    carrier->height = height;
+    carrier->channels = spp;
+    return e_success;
+}
+
+// Function to describe the strips of a TIFF file as spans
+static Status get_tiff_span(const Carrier *carrier, long index, long *offset, long *size)
+{
+    if (index >= carrier->nstrips)
+        return e_failure;
+    *offset = carrier->strip_offsets[index];
+    *size = carrier->strip_sizes[index];
+    return e_success;
+}
+
+static const CarrierCodec carrier_codecs[] = {
+    {"BMP", {".bmp", NULL}, 0, parse_bmp_header, get_row_span},
+    {"PPM/PGM", {".ppm", ".pgm", ".pnm", NULL}, 0, parse_pnm_header, get_row_span},
+    {"raw RGB", {".rgb", ".raw", NULL}, 1, parse_raw_header, get_row_span},
+    {"TIFF", {".tif", ".tiff", NULL}, 0, parse_tiff_header, get_tiff_span},
+};
+
+// Function to find the codec for a file name by its extension
+const CarrierCodec *carrier_codec_for_file(const char *fname)
+{
+    const char *extn = strrchr(fname, '.');
+
+    if (extn == NULL)
+        return NULL;
+    for (size_t i = 0; i < sizeof(carrier_codecs) / sizeof(carrier_codecs[0]); i++)
+        for (int j = 0; carrier_codecs[i].extensions[j] != NULL; j++)
+            if (strcasecmp(extn, carrier_codecs[i].extensions[j]) == 0)
+                return &carrier_codecs[i];
+    return NULL;
+}
+
+// Function to parse the carrier header (width and height are used by raw RGB)
+Status carrier_open(Carrier *carrier, const char *fname, FILE *fptr, uint width, uint height)
+{
+    memset(carrier, 0, sizeof(*carrier));
+    carrier->codec = carrier_codec_for_file(fname);
+    carrier->fptr = fptr;
+    carrier->width = width;
+    carrier->height = height;
+
+    if (carrier->codec == NULL)
+    {
+        printf("ERROR: Unsupported image format %s\n", fname);
+        return e_failure;
+    }
+    if (carrier->codec->parse_header(carrier) == e_failure)
+    {
+        carrier_close(carrier);
+        return e_failure;
+    }
+    return e_success;
+}
+
+// Function to release memory held by the carrier
+void carrier_close(Carrier *carrier)
+{
+    free(carrier->strip_offsets);
+    free(carrier->strip_sizes);
+    carrier->strip_offsets = NULL;
+    carrier->strip_sizes = NULL;
+    carrier->nstrips = 0;
+}
+
+// Function to get the number of pixel bytes available for hiding data
+long carrier_capacity(const Carrier *carrier)
+{
+    long offset, size, total = 0;
+
+    for (long i = 0; carrier->codec->get_span(carrier, i, &offset, &size) == e_success; i++)
+        total += size;
+    return total;
+}
+
+// Function to copy n bytes from one file to another
+static Status copy_bytes(FILE *fptr_src, FILE *fptr_dest, long n)
+{
+    char buffer[CARRIER_COPY_SIZE];
+
+    while (n > 0)
+    {
+        long chunk = n < CARRIER_COPY_SIZE ? n : CARRIER_COPY_SIZE;
+        if (fread(buffer, chunk, 1, fptr_src) != 1)
+            return e_failure;
+        fwrite(buffer, chunk, 1, fptr_dest);
+        n -= chunk;
+    }
+    return e_success;
+}
+
+// Function to move a cursor into its next span, returning the span offset
+static Status enter_next_span(const Carrier *carrier, CarrierCursor *cursor, long *offset)
+{
+    long size;
+
+    if (carrier->codec->get_span(carrier, cursor->span, offset, &size) == e_failure)
+    {
+        printf("ERROR: Not enough pixel data in image\n");
+        return e_failure;
+    }
+    cursor->span++;
+    cursor->left = size;
+    cursor->end = *offset + size;
+    return e_success;
+}
+
+// Function to reset both cursors to the start of the pixel data
+static long rewind_cursors(Carrier *carrier)
+{
+    long offset = 0, size;
+
+    memset(&carrier->rd, 0, sizeof(carrier->rd));
+    if (carrier->codec->get_span(carrier, 0, &offset, &size) == e_success)
+        carrier->rd.end = offset;
+    carrier->wr = carrier->rd;
+    return carrier->rd.end;
+}
+
+// Function to copy everything before the first pixel span to the output
+Status carrier_write_header(Carrier *carrier, FILE *fptr_dest)
+{
+    long header_size = rewind_cursors(carrier);
+
+    rewind(carrier->fptr);
+    return copy_bytes(carrier->fptr, fptr_dest, header_size);
+}
+
+// Function to move the read cursor to the first pixel span without copying
+Status carrier_skip_header(Carrier *carrier)
+{
+    fseek(carrier->fptr, rewind_cursors(carrier), SEEK_SET);
+    return e_success;
+}
+
+// Function to read the next n pixel bytes
+Status carrier_read_pixels(Carrier *carrier, char *buffer, long n)
+{
+    CarrierCursor *rd = &carrier->rd;
+
+    while (n > 0)
+    {
+        if (rd->left == 0)
+        {
+            long offset;
+            if (enter_next_span(carrier, rd, &offset) == e_failure)
+                return e_failure;
+            fseek(carrier->fptr, offset, SEEK_SET);
+            continue;
+        }
+
+        long chunk = n < rd->left ? n : rd->left;
+        if (fread(buffer, chunk, 1, carrier->fptr) != 1)
+            return e_failure;
+        buffer += chunk;
+        rd->left -= chunk;
+        n -= chunk;
+    }
+    return e_success;
+}
+
+// Function to write the next n pixel bytes, copying any bytes between spans
+Status carrier_write_pixels(Carrier *carrier, const char *buffer, long n, FILE *fptr_dest)
+{
+    CarrierCursor *wr = &carrier->wr;
+
+    while (n > 0)
+    {
+        if (wr->left == 0)
+        {
+            long gap_start = wr->end, offset;
+            if (enter_next_span(carrier, wr, &offset) == e_failure)
+                return e_failure;
+
+            // Rows are usually back to back; only TIFF strips leave gaps to copy
+            if (offset > gap_start)
+            {
+                long pos = ftell(carrier->fptr);
+                fseek(carrier->fptr, gap_start, SEEK_SET);
+                Status status = copy_bytes(carrier->fptr, fptr_dest, offset - gap_start);
+                fseek(carrier->fptr, pos, SEEK_SET);
+                if (status == e_failure)
+                    return e_failure;
+            }
+            continue;
+        }
+
+        long chunk = n < wr->left ? n : wr->left;
+        fwrite(buffer, chunk, 1, fptr_dest);
+        buffer += chunk;
+        wr->left -= chunk;
+        n -= chunk;
+    }
+    return e_success;
+}
@@ -0,0 +1,75 @@
+#ifndef CARRIER_H
+#define CARRIER_H
+
+#include <stdio.h>
+#include "types.h"
+
+typedef struct _Carrier Carrier;
+
+/*
+ * A carrier codec knows where a file format keeps its pixel bytes. It
+ * parses the header and describes the pixel data as numbered spans
+ * (rows, or strips for TIFF) in file order. Everything outside the spans
+ * is copied through unchanged, so the stego file keeps the same format.
+ */
+typedef struct _CarrierCodec
+{
+    const char *name;                    // Format name shown to the user
+    const char *extensions[4];           // Recognised file extensions, NULL terminated
+    int needs_geometry;                  // Whether width and height must be given
+    Status (*parse_header)(Carrier *carrier);
+    Status (*get_span)(const Carrier *carrier, long index, long *offset, long *size);
+} CarrierCodec;
+
+/* Position of a pixel span iterator */
+typedef struct _CarrierCursor
+{
+    long span;       // Index of the next span to enter
+    long left;       // Pixel bytes left in the current span
+    long end;        // File offset just past the current span
+} CarrierCursor;
+
+/* An opened carrier file and its pixel layout */
+struct _Carrier
+{
+    const CarrierCodec *codec;   // Codec chosen from the file extension
+    FILE *fptr;                  // Carrier file being read
+    uint width;                  // Width in pixels
+    uint height;                 // Height in pixels
+    uint channels;               // Samples per pixel
+    long data_offset;            // Offset of the first row
+    long row_size;               // Pixel bytes in one row span
+    long row_stride;             // Bytes from one row to the next
+    int big_endian;              // TIFF byte order
+    long nstrips;                // TIFF strip count
+    long *strip_offsets;         // TIFF strip offsets
+    long *strip_sizes;           // TIFF strip byte counts
+    CarrierCursor rd;            // Read cursor into fptr
+    CarrierCursor wr;            // Write cursor into the output file
+};
+
+// Function to find the codec for a file name by its extension
+const CarrierCodec *carrier_codec_for_file(const char *fname);
+
+// Function to parse the carrier header (width and height are used by raw RGB)
+Status carrier_open(Carrier *carrier, const char *fname, FILE *fptr, uint width, uint height);
+
+// Function to release memory held by the carrier
+void carrier_close(Carrier *carrier);
+
+// Function to get the number of pixel bytes available for hiding data
+long carrier_capacity(const Carrier *carrier);
+
+// Function to copy everything before the first pixel span to the output
+Status carrier_write_header(Carrier *carrier, FILE *fptr_dest);
+
+// Function to move the read cursor to the first pixel span without copying
+Status carrier_skip_header(Carrier *carrier);
+
+// Function to read the next n pixel bytes
+Status carrier_read_pixels(Carrier *carrier, char *buffer, long n);
+
+// Function to write the next n pixel bytes, copying any bytes between spans
+Status carrier_write_pixels(Carrier *carrier, const char *buffer, long n, FILE *fptr_dest);
+
+#endif
@@ -0,0 +1,550 @@
+#include <stdio.h>
+#include <string.h>
+#include "cipher.h"
+#include "types.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CIPHER_HAVE_X86 1
+#endif
+
+// Chained HChaCha20 calls used to stretch a passphrase (about 0.2 s per encode or decode at -O2)
+#define CIPHER_KDF_ROUNDS (1L << 20)
+
+// Keystream generator in use, fills CIPHER_BATCH bytes from state
+static void (*chacha_batch)(const uint state[16], uchar *out);
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTER_ROUND(a, b, c, d)                 \
+    do                                            \
+    {                                             \
+        a += b; d ^= a; d = ROTL32(d, 16);        \
+        c += d; b ^= c; b = ROTL32(b, 12);        \
+        a += b; d ^= a; d = ROTL32(d, 8);         \
+        c += d; b ^= c; b = ROTL32(b, 7);         \
+    } while (0)
+
+// Function to read a little-endian 32-bit word
+static uint load_le32(const uchar *p)
+{
+    return (uint)p[0] | ((uint)p[1] << 8) | ((uint)p[2] << 16) | ((uint)p[3] << 24);
+}
+
+// Function to write a little-endian 32-bit word
+static void store_le32(uchar *p, uint v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+// Function to run the 20 ChaCha rounds over x
+static void chacha_rounds(uint x[16])
+{
+    for (int i = 0; i < 10; i++)
+    {
+        QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+}
+
+// Function to fill the constants and key words of a ChaCha state
+static void chacha_setup(uint state[16], const uchar key[CIPHER_KEY_SIZE])
+{
+    state[0] = 0x61707865;  // "expand 32-byte k"
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++)
+        state[4 + i] = load_le32(key + 4 * i);
+}
+
+// Function to derive a subkey from a key and 16 input bytes (HChaCha20)
+static void hchacha20(const uchar key[CIPHER_KEY_SIZE], const uchar in[16], uchar out[CIPHER_KEY_SIZE])
+{
+    uint x[16];
+
+    chacha_setup(x, key);
+    for (int i = 0; i < 4; i++)
+        x[12 + i] = load_le32(in + 4 * i);
+    chacha_rounds(x);
+
+    for (int i = 0; i < 4; i++)
+    {
+        store_le32(out + 4 * i, x[i]);
+        store_le32(out + 16 + 4 * i, x[12 + i]);
+    }
+}
+
+// Function to generate a batch of keystream blocks one at a time
+static void chacha_batch_scalar(const uint state[16], uchar *out)
+{
+    uint x[16];
+
+    for (int b = 0; b < CIPHER_BATCH / 64; b++)
+    {
+        memcpy(x, state, sizeof(x));
+        x[12] += b;
+        chacha_rounds(x);
+        for (int i = 0; i < 16; i++)
+            store_le32(out + 64 * b + 4 * i, x[i] + state[i] + (i == 12 ? b : 0));
+    }
+}
+
+#ifdef CIPHER_HAVE_X86
+#define ROTL128(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define QR128(a, b, c, d)                                                              \
+    do                                                                                 \
+    {                                                                                  \
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 16);          \
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 12);          \
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 8);           \
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 7);           \
+    } while (0)
+
+/*
+ * Function to generate four blocks with SSE2. Each register holds one
+ * state word of four consecutive blocks, so the rounds need no shuffles
+ * and a 4x4 transpose at the end restores the block byte order.
+ */
+__attribute__((target("sse2")))
+static void chacha_blocks4_sse2(const uint state[16], uint first, uchar *out)
+{
+    __m128i x[16], orig[16];
+
+    for (int i = 0; i < 16; i++)
+        x[i] = _mm_set1_epi32(state[i]);
+    x[12] = _mm_add_epi32(x[12], _mm_set_epi32(first + 3, first + 2, first + 1, first));
+    memcpy(orig, x, sizeof(x));
+
+    for (int i = 0; i < 10; i++)
+    {
+        QR128(x[0], x[4], x[8], x[12]);
+        QR128(x[1], x[5], x[9], x[13]);
+        QR128(x[2], x[6], x[10], x[14]);
+        QR128(x[3], x[7], x[11], x[15]);
+        QR128(x[0], x[5], x[10], x[15]);
+        QR128(x[1], x[6], x[11], x[12]);
+        QR128(x[2], x[7], x[8], x[13]);
+        QR128(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int g = 0; g < 4; g++)
+    {
+        __m128i a = _mm_add_epi32(x[4 * g], orig[4 * g]);
+        __m128i b = _mm_add_epi32(x[4 * g + 1], orig[4 * g + 1]);
+        __m128i c = _mm_add_epi32(x[4 * g + 2], orig[4 * g + 2]);
+        __m128i d = _mm_add_epi32(x[4 * g + 3], orig[4 * g + 3]);
+        __m128i t0 = _mm_unpacklo_epi32(a, b);
+        __m128i t1 = _mm_unpacklo_epi32(c, d);
+        __m128i t2 = _mm_unpackhi_epi32(a, b);
+        __m128i t3 = _mm_unpackhi_epi32(c, d);
+
+        _mm_storeu_si128((__m128i *)(out + 0 * 64 + 16 * g), _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)(out + 1 * 64 + 16 * g), _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)(out + 2 * 64 + 16 * g), _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128((__m128i *)(out + 3 * 64 + 16 * g), _mm_unpackhi_epi64(t2, t3));
+    }
+}
+
+// Function to generate a batch of keystream with SSE2, four blocks at a time
+__attribute__((target("sse2")))
+static void chacha_batch_sse2(const uint state[16], uchar *out)
+{
+    for (int b = 0; b < CIPHER_BATCH / 64; b += 4)
+        chacha_blocks4_sse2(state, b, out + 64 * b);
+}
+
+#define ROTL256(v, n) _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+#define QR256(a, b, c, d)                                                                    \
+    do                                                                                       \
+    {                                                                                        \
+        a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = ROTL256(d, 16);          \
+        c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = ROTL256(b, 12);          \
+        a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = ROTL256(d, 8);           \
+        c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = ROTL256(b, 7);           \
+    } while (0)
+
+/*
+ * Function to generate a whole batch (eight blocks) with AVX2. The
+ * transpose works per 128-bit lane, so the low lane ends up holding
+ * blocks 0-3 and the high lane blocks 4-7.
+ */
+__attribute__((target("avx2")))
+static void chacha_batch_avx2(const uint state[16], uchar *out)
+{
+    __m256i x[16], orig[16];
+
+    for (int i = 0; i < 16; i++)
+        x[i] = _mm256_set1_epi32(state[i]);
+    x[12] = _mm256_add_epi32(x[12], _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    memcpy(orig, x, sizeof(x));
+
+    for (int i = 0; i < 10; i++)
+    {
+        QR256(x[0], x[4], x[8], x[12]);
+        QR256(x[1], x[5], x[9], x[13]);
+        QR256(x[2], x[6], x[10], x[14]);
+        QR256(x[3], x[7], x[11], x[15]);
+        QR256(x[0], x[5], x[10], x[15]);
+        QR256(x[1], x[6], x[11], x[12]);
+        QR256(x[2], x[7], x[8], x[13]);
+        QR256(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int g = 0; g < 4; g++)
+    {
+        __m256i a = _mm256_add_epi32(x[4 * g], orig[4 * g]);
+        __m256i b = _mm256_add_epi32(x[4 * g + 1], orig[4 * g + 1]);
+        __m256i c = _mm256_add_epi32(x[4 * g + 2], orig[4 * g + 2]);
+        __m256i d = _mm256_add_epi32(x[4 * g + 3], orig[4 * g + 3]);
+        __m256i t0 = _mm256_unpacklo_epi32(a, b);
+        __m256i t1 = _mm256_unpacklo_epi32(c, d);
+        __m256i t2 = _mm256_unpackhi_epi32(a, b);
+        __m256i t3 = _mm256_unpackhi_epi32(c, d);
+        __m256i blk[4];
+
+        blk[0] = _mm256_unpacklo_epi64(t0, t1);
+        blk[1] = _mm256_unpackhi_epi64(t0, t1);
+        blk[2] = _mm256_unpacklo_epi64(t2, t3);
+        blk[3] = _mm256_unpackhi_epi64(t2, t3);
+        for (int j = 0; j < 4; j++)
+        {
+            _mm_storeu_si128((__m128i *)(out + j * 64 + 16 * g), _mm256_castsi256_si128(blk[j]));
+            _mm_storeu_si128((__m128i *)(out + (j + 4) * 64 + 16 * g), _mm256_extracti128_si256(blk[j], 1));
+        }
+    }
+}
+#endif
+
+// Function to pick the keystream generator for this CPU once
+static void chacha_select(void)
+{
+    if (chacha_batch)
+        return;
+
+    chacha_batch = chacha_batch_scalar;
+#ifdef CIPHER_HAVE_X86
+    if (__builtin_cpu_supports("avx2"))
+        chacha_batch = chacha_batch_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+        chacha_batch = chacha_batch_sse2;
+#endif
+}
+
+// Function to generate the next keystream batch and advance the counter
+static void chacha_refill(CipherCtx *ctx)
+{
+    chacha_batch(ctx->state, ctx->stream);
+    ctx->state[12] += CIPHER_BATCH / 64;
+    ctx->stream_pos = 0;
+}
+
+// Function to start a Poly1305 tag with a one-time key
+static void poly1305_init(Poly1305 *mac, const uchar key[32])
+{
+    uint t0 = load_le32(key), t1 = load_le32(key + 4);
+    uint t2 = load_le32(key + 8), t3 = load_le32(key + 12);
+
+    // Clamp r as required by the specification
+    mac->r[0] = t0 & 0x3ffffff;
+    mac->r[1] = ((t0 >> 26) | (t1 << 6)) & 0x3ffff03;
+    mac->r[2] = ((t1 >> 20) | (t2 << 12)) & 0x3ffc0ff;
+    mac->r[3] = ((t2 >> 14) | (t3 << 18)) & 0x3f03fff;
+    mac->r[4] = (t3 >> 8) & 0x00fffff;
+
+    memset(mac->h, 0, sizeof(mac->h));
+    for (int i = 0; i < 4; i++)
+        mac->pad[i] = load_le32(key + 16 + 4 * i);
+    mac->buf_len = 0;
+}
+
+// Function to absorb one full 16-byte block into the accumulator
+static void poly1305_block(Poly1305 *mac, const uchar *m)
+{
+    uint r0 = mac->r[0], r1 = mac->r[1], r2 = mac->r[2], r3 = mac->r[3], r4 = mac->r[4];
+    uint s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint h0, h1, h2, h3, h4;
+    unsigned long long d0, d1, d2, d3, d4;
+    uint c;
+
+    h0 = mac->h[0] + (load_le32(m) & 0x3ffffff);
+    h1 = mac->h[1] + ((load_le32(m + 3) >> 2) & 0x3ffffff);
+    h2 = mac->h[2] + ((load_le32(m + 6) >> 4) & 0x3ffffff);
+    h3 = mac->h[3] + ((load_le32(m + 9) >> 6) & 0x3ffffff);
+    h4 = mac->h[4] + ((load_le32(m + 12) >> 8) | (1 << 24));
+
+    d0 = (unsigned long long)h0 * r0 + (unsigned long long)h1 * s4 + (unsigned long long)h2 * s3 +
+         (unsigned long long)h3 * s2 + (unsigned long long)h4 * s1;
+    d1 = (unsigned long long)h0 * r1 + (unsigned long long)h1 * r0 + (unsigned long long)h2 * s4 +
+         (unsigned long long)h3 * s3 + (unsigned long long)h4 * s2;
+    d2 = (unsigned long long)h0 * r2 + (unsigned long long)h1 * r1 + (unsigned long long)h2 * r0 +
+         (unsigned long long)h3 * s4 + (unsigned long long)h4 * s3;
+    d3 = (unsigned long long)h0 * r3 + (unsigned long long)h1 * r2 + (unsigned long long)h2 * r1 +
+         (unsigned long long)h3 * r0 + (unsigned long long)h4 * s4;
+    d4 = (unsigned long long)h0 * r4 + (unsigned long long)h1 * r3 + (unsigned long long)h2 * r2 +
+         (unsigned long long)h3 * r1 + (unsigned long long)h4 * r0;
+
+    c = d0 >> 26; h0 = d0 & 0x3ffffff;
+    d1 += c; c = d1 >> 26; h1 = d1 & 0x3ffffff;
+    d2 += c; c = d2 >> 26; h2 = d2 & 0x3ffffff;
+    d3 += c; c = d3 >> 26; h3 = d3 & 0x3ffffff;
+    d4 += c; c = d4 >> 26; h4 = d4 & 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    mac->h[0] = h0;
+    mac->h[1] = h1;
+    mac->h[2] = h2;
+    mac->h[3] = h3;
+    mac->h[4] = h4;
+}
+
+// Function to absorb bytes, buffering any partial block
+static void poly1305_update(Poly1305 *mac, const uchar *m, long len)
+{
+    if (mac->buf_len)
+    {
+        while (len > 0 && mac->buf_len < 16)
+        {
+            mac->buf[mac->buf_len++] = *m++;
+            len--;
+        }
+        if (mac->buf_len < 16)
+            return;
+        poly1305_block(mac, mac->buf);
+        mac->buf_len = 0;
+    }
+    for (; len >= 16; len -= 16, m += 16)
+        poly1305_block(mac, m);
+    memcpy(mac->buf, m, len);
+    mac->buf_len = len;
+}
+
+// Function to zero-pad the absorbed data to a 16-byte boundary
+static void poly1305_pad(Poly1305 *mac)
+{
+    if (mac->buf_len == 0)
+        return;
+    memset(mac->buf + mac->buf_len, 0, 16 - mac->buf_len);
+    poly1305_block(mac, mac->buf);
+    mac->buf_len = 0;
+}
+
+// Function to reduce the accumulator and add the final pad
+static void poly1305_final(Poly1305 *mac, uchar tag[CIPHER_TAG_SIZE])
+{
+    uint h0 = mac->h[0], h1 = mac->h[1], h2 = mac->h[2], h3 = mac->h[3], h4 = mac->h[4];
+    uint g0, g1, g2, g3, g4, c, mask;
+    unsigned long long f;
+
+    c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    // Compute h - p and keep it when it does not underflow
+    g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    g4 = h4 + c - (1 << 26);
+
+    mask = (g4 >> 31) - 1;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    f = (unsigned long long)h0 + mac->pad[0];
+    store_le32(tag, f);
+    f = (unsigned long long)h1 + mac->pad[1] + (f >> 32);
+    store_le32(tag + 4, f);
+    f = (unsigned long long)h2 + mac->pad[2] + (f >> 32);
+    store_le32(tag + 8, f);
+    f = (unsigned long long)h3 + mac->pad[3] + (f >> 32);
+    store_le32(tag + 12, f);
+}
+
+// Function to read a raw key written as 64 hex digits
+Status cipher_parse_key(const char *hex, uchar key[CIPHER_KEY_SIZE])
+{
+    if (strlen(hex) != 2 * CIPHER_KEY_SIZE)
+        return e_failure;
+    for (int i = 0; i < 2 * CIPHER_KEY_SIZE; i++)
+    {
+        int ch = hex[i], digit;
+        if (ch >= '0' && ch <= '9')
+            digit = ch - '0';
+        else if (ch >= 'a' && ch <= 'f')
+            digit = ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'F')
+            digit = ch - 'A' + 10;
+        else
+            return e_failure;
+        key[i / 2] = (i % 2) ? (key[i / 2] | digit) : (digit << 4);
+    }
+    return e_success;
+}
+
+// Function to get the message key from a raw hex key, or stretch it from a passphrase
+void cipher_get_key(const char *secret, int passphrase, const uchar salt[CIPHER_SALT_SIZE],
+                    uchar key[CIPHER_KEY_SIZE])
+{
+    if (passphrase)
+        cipher_derive_key(secret, salt, key);
+    else
+        cipher_parse_key(secret, key);
+}
+
+// Function to derive a key from a passphrase and salt with chained HChaCha20 calls
+void cipher_derive_key(const char *passphrase, const uchar salt[CIPHER_SALT_SIZE], uchar key[CIPHER_KEY_SIZE])
+{
+    long len = strlen(passphrase);
+    uchar block[16];
+
+    // The salt goes in first, so no part of the chain can be precomputed per passphrase
+    memset(key, 0, CIPHER_KEY_SIZE);
+    hchacha20(key, salt, key);
+    for (long i = 0; i < len; i += 16)
+    {
+        memset(block, 0, sizeof(block));
+        memcpy(block, passphrase + i, len - i < 16 ? len - i : 16);
+        hchacha20(key, block, key);
+    }
+
+    // Stretch with the salt, length and round number in every block
+    for (long i = 0; i < CIPHER_KDF_ROUNDS; i++)
+    {
+        memcpy(block, salt, sizeof(block));
+        store_le32(block + 8, load_le32(block + 8) ^ (uint)len);
+        store_le32(block + 12, load_le32(block + 12) ^ (uint)i);
+        hchacha20(key, block, key);
+    }
+}
+
+// Function to fill a fresh random salt
+Status cipher_random_salt(uchar salt[CIPHER_SALT_SIZE])
+{
+    FILE *fptr = fopen("/dev/urandom", "rb");
+
+    // A repeated salt would reuse the keystream, so there is no fallback
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open /dev/urandom for the salt\n");
+        return e_failure;
+    }
+    size_t got = fread(salt, CIPHER_SALT_SIZE, 1, fptr);
+    fclose(fptr);
+    if (got != 1)
+    {
+        fprintf(stderr, "ERROR: Unable to read a random salt from /dev/urandom\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+// Function to start a message, authenticating aad_len header bytes
+void cipher_start(CipherCtx *ctx, const uchar key[CIPHER_KEY_SIZE], const uchar salt[CIPHER_SALT_SIZE],
+                  const uchar *aad, long aad_len)
+{
+    uchar subkey[CIPHER_KEY_SIZE];
+
+    chacha_select();
+
+    // A fresh subkey per salt lets the nonce stay zero (as in XChaCha20)
+    hchacha20(key, salt, subkey);
+    chacha_setup(ctx->state, subkey);
+    memset(ctx->state + 12, 0, 4 * sizeof(uint));
+
+    // Block 0 keys Poly1305, the ciphertext starts at block 1
+    chacha_refill(ctx);
+    poly1305_init(&ctx->mac, ctx->stream);
+    ctx->stream_pos = 64;
+
+    poly1305_update(&ctx->mac, aad, aad_len);
+    poly1305_pad(&ctx->mac);
+    ctx->aad_len = aad_len;
+    ctx->text_len = 0;
+}
+
+// Function to XOR a chunk with the keystream
+static void cipher_xor(CipherCtx *ctx, uchar *buf, long len)
+{
+    while (len > 0)
+    {
+        if (ctx->stream_pos == CIPHER_BATCH)
+            chacha_refill(ctx);
+
+        long n = CIPHER_BATCH - ctx->stream_pos;
+        if (n > len)
+            n = len;
+        for (long i = 0; i < n; i++)
+            buf[i] ^= ctx->stream[ctx->stream_pos + i];
+
+        ctx->stream_pos += n;
+        buf += n;
+        len -= n;
+    }
+}
+
+// Function to encrypt a chunk in place and add it to the tag
+void cipher_encrypt(CipherCtx *ctx, uchar *buf, long len)
+{
+    cipher_xor(ctx, buf, len);
+    poly1305_update(&ctx->mac, buf, len);
+    ctx->text_len += len;
+}
+
+// Function to add a chunk to the tag and decrypt it in place
+void cipher_decrypt(CipherCtx *ctx, uchar *buf, long len)
+{
+    poly1305_update(&ctx->mac, buf, len);
+    cipher_xor(ctx, buf, len);
+    ctx->text_len += len;
+}
+
+// Function to finish the message and produce its tag
+void cipher_finish(CipherCtx *ctx, uchar tag[CIPHER_TAG_SIZE])
+{
+    uchar lengths[16] = {0};
+
+    poly1305_pad(&ctx->mac);
+    store_le32(lengths, ctx->aad_len);
+    store_le32(lengths + 4, (unsigned long long)ctx->aad_len >> 32);
+    store_le32(lengths + 8, ctx->text_len);
+    store_le32(lengths + 12, (unsigned long long)ctx->text_len >> 32);
+    poly1305_update(&ctx->mac, lengths, 16);
+    poly1305_final(&ctx->mac, tag);
+}
+
+// Function to finish the message and compare against the stored tag
+Status cipher_verify(CipherCtx *ctx, const uchar tag[CIPHER_TAG_SIZE])
+{
+    uchar expected[CIPHER_TAG_SIZE];
+    uchar diff = 0;
+
+    cipher_finish(ctx, expected);
+
+    // Compare every byte so the time taken does not leak the mismatch
+    for (int i = 0; i < CIPHER_TAG_SIZE; i++)
+        diff |= expected[i] ^ tag[i];
+    return diff == 0 ? e_success : e_failure;
+}
@@ -0,0 +1,69 @@
+#ifndef CIPHER_H
+#define CIPHER_H
+
+#include "types.h"
+
+// Sizes of the ChaCha20-Poly1305 key and the values kept in the stego header
+#define CIPHER_KEY_SIZE 32
+#define CIPHER_SALT_SIZE 16
+#define CIPHER_TAG_SIZE 16
+#define CIPHER_HEADER_SIZE (CIPHER_SALT_SIZE + CIPHER_TAG_SIZE)
+
+// Keystream generated per refill (8 ChaCha20 blocks, one AVX2 pass)
+#define CIPHER_BATCH 512
+
+/* Streaming Poly1305 state (26-bit limbs) */
+typedef struct _Poly1305
+{
+    uint r[5];         // Clamped multiplier
+    uint h[5];         // Accumulator
+    uint pad[4];       // Final addend
+    uchar buf[16];     // Pending partial block
+    int buf_len;       // Bytes pending in buf
+} Poly1305;
+
+/*
+ * ChaCha20-Poly1305 (RFC 8439) over a subkey derived from the key and a
+ * random salt, so the nonce itself can stay fixed. The keystream is made
+ * in batches kept in L1 and consumed by the embed and extract loops.
+ */
+typedef struct _CipherCtx
+{
+    uint state[16];                // ChaCha20 input block for the next batch
+    uchar stream[CIPHER_BATCH];    // Keystream batch
+    int stream_pos;                // Next unused byte of stream
+    Poly1305 mac;                  // Tag over header and ciphertext
+    long aad_len;                  // Authenticated header bytes
+    long text_len;                 // Ciphertext bytes so far
+} CipherCtx;
+
+// Function to read a raw key written as 64 hex digits
+Status cipher_parse_key(const char *hex, uchar key[CIPHER_KEY_SIZE]);
+
+// Function to get the message key from a raw hex key, or stretch it from a passphrase
+void cipher_get_key(const char *secret, int passphrase, const uchar salt[CIPHER_SALT_SIZE],
+                    uchar key[CIPHER_KEY_SIZE]);
+
+// Function to derive a key from a passphrase and salt (slow on purpose)
+void cipher_derive_key(const char *passphrase, const uchar salt[CIPHER_SALT_SIZE], uchar key[CIPHER_KEY_SIZE]);
+
+// Function to fill a fresh random salt from the system
+Status cipher_random_salt(uchar salt[CIPHER_SALT_SIZE]);
+
+// Function to start a message, authenticating aad_len header bytes
+void cipher_start(CipherCtx *ctx, const uchar key[CIPHER_KEY_SIZE], const uchar salt[CIPHER_SALT_SIZE],
+                  const uchar *aad, long aad_len);
+
+// Function to encrypt a chunk in place and add it to the tag
+void cipher_encrypt(CipherCtx *ctx, uchar *buf, long len);
+
+// Function to add a chunk to the tag and decrypt it in place
+void cipher_decrypt(CipherCtx *ctx, uchar *buf, long len);
+
+// Function to finish the message and produce its tag
+void cipher_finish(CipherCtx *ctx, uchar tag[CIPHER_TAG_SIZE]);
+
+// Function to finish the message and compare against the stored tag
+Status cipher_verify(CipherCtx *ctx, const uchar tag[CIPHER_TAG_SIZE]);
+
+#endif
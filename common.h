@@ -4,4 +4,13 @@
 /* Magic string to identify whether stegged or not */
 #define MAGIC_STRING "#*"
 
+/* Magic string for stego data protected by Reed-Solomon FEC */
+#define MAGIC_STRING_FEC "$~"
+
+/* Magic string for stego data encrypted with ChaCha20-Poly1305 */
+#define MAGIC_STRING_CRYPT "#@"
+
+/* Set in the FEC parity level byte when the secret data is encrypted */
+#define FEC_FLAG_ENCRYPTED 0x80
+
 #endif
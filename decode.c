@@ -1,17 +1,21 @@
 #include <stdio.h>
 #include <string.h>
 #include "decode.h"
+#include "common.h"
+#include "fec.h"
+#include "cipher.h"
+#include "carrier.h"
 #include "types.h"
 
 // Function to read and validate decode arguments
 Status read_and_validate_decode_args(char *argv[], DecodeInfo *decInfo)
 {
     // Validate the stego image file
-    if (argv[2] && strstr(argv[2], ".bmp"))
+    if (argv[2] && carrier_codec_for_file(argv[2]))
         decInfo->stego_image_fname = argv[2];
     else
     {
-        printf("ERROR: Stego image file must be a .bmp file\n");
+        printf("ERROR: Stego image file must be a .bmp, .ppm, .pgm, .tif or .rgb file\n");
         return e_failure;
     }
 
@@ -63,6 +67,16 @@ int decode_size_from_lsb(char *image_buffer)
     return size;
 }
 
+// Function to count the differing bits between two magic strings
+static int magic_string_distance(const char *a, const char *b, int size)
+{
+    int bits = 0;
+    for (int i = 0; i < size; i++)
+        for (uchar diff = a[i] ^ b[i]; diff; diff &= diff - 1)
+            bits++;
+    return bits;
+}
+
 // Function to decode and verify the magic string
 Status decode_magic_string(DecodeInfo *decInfo)
 {
@@ -72,16 +86,30 @@ Status decode_magic_string(DecodeInfo *decInfo)
 
     for (i = 0; i < strlen(MAGIC_STRING); i++)
     {
-        fread(image_buffer, 8, 1, decInfo->fptr_stego_image);
+        carrier_read_pixels(&decInfo->carrier, image_buffer, 8);
         magic_string[i] = decode_byte_from_lsb(image_buffer);
     }
     magic_string[i] = '\0';
 
+    decInfo->fec_parity = 0;
+    decInfo->encrypted = 0;
     if (strcmp(magic_string, MAGIC_STRING) == 0)
     {
         printf("Magic string matched successfully\n");
         return e_success;
     }
+    else if (strcmp(magic_string, MAGIC_STRING_CRYPT) == 0)
+    {
+        printf("Magic string matched successfully (encrypted data)\n");
+        decInfo->encrypted = 1;
+        return e_success;
+    }
+    // The FEC magic is far from the plain one, so tolerate a couple of flipped bits
+    else if (magic_string_distance(magic_string, MAGIC_STRING_FEC, strlen(MAGIC_STRING_FEC)) <= 2)
+    {
+        printf("FEC magic string matched successfully\n");
+        return decode_fec_parity_level(decInfo);
+    }
     else
     {
         printf("ERROR: Magic string mismatch\n");
@@ -93,7 +121,7 @@ Status decode_magic_string(DecodeInfo *decInfo)
 int decode_secret_file_extn_size(DecodeInfo *decInfo)
 {
     char image_buffer[32];
-    fread(image_buffer, 32, 1, decInfo->fptr_stego_image);
+    carrier_read_pixels(&decInfo->carrier, image_buffer, 32);
     return decode_size_from_lsb(image_buffer);
 }
 
@@ -103,7 +131,7 @@ Status decode_secret_file_extn(DecodeInfo *decInfo, int extn_size)
     char image_buffer[8];
     for (int i = 0; i < extn_size; i++)
     {
-        fread(image_buffer, 8, 1, decInfo->fptr_stego_image);
+        carrier_read_pixels(&decInfo->carrier, image_buffer, 8);
         decInfo->file_extn[i] = decode_byte_from_lsb(image_buffer);
     }
     decInfo->file_extn[extn_size] = '\0';
@@ -115,27 +143,172 @@ Status decode_secret_file_extn(DecodeInfo *decInfo, int extn_size)
 long decode_secret_file_size(DecodeInfo *decInfo)
 {
     char image_buffer[32];
-    fread(image_buffer, 32, 1, decInfo->fptr_stego_image);
+    carrier_read_pixels(&decInfo->carrier, image_buffer, 32);
     return decode_size_from_lsb(image_buffer);
 }
 
-// Function to decode the hidden secret file data
+// Function to decode the hidden secret file data, decrypting each chunk in the same pass
 Status decode_secret_file_data(DecodeInfo *decInfo, long file_size)
 {
-    char image_buffer[8];
-    char ch;
+    char data[DECODE_CHUNK_SIZE];
+
+    while (file_size > 0)
+    {
+        long size = file_size < DECODE_CHUNK_SIZE ? file_size : DECODE_CHUNK_SIZE;
+        if (decode_buffer_from_image(data, size, decInfo) == e_failure)
+            return e_failure;
+        if (decInfo->encrypted)
+            cipher_decrypt(&decInfo->cipher, (uchar *)data, size);
+        fwrite(data, size, 1, decInfo->fptr_output);
+        file_size -= size;
+    }
+
+    printf("Secret data decoded successfully\n");
+    return e_success;
+}
+
+// Function to decode a buffer of bytes from image data, 8 image bytes per byte
+Status decode_buffer_from_image(char *buffer, long size, DecodeInfo *decInfo)
+{
+    char image_buffer[DECODE_CHUNK_SIZE * 8];
+    while (size > 0)
+    {
+        long n = size < DECODE_CHUNK_SIZE ? size : DECODE_CHUNK_SIZE;
+        if (carrier_read_pixels(&decInfo->carrier, image_buffer, 8 * n) == e_failure)
+            return e_failure;
+        for (long i = 0; i < n; i++)
+            buffer[i] = decode_byte_from_lsb(image_buffer + 8 * i);
+
+        buffer += n;
+        size -= n;
+    }
+    return e_success;
+}
+
+// Function to decode the FEC parity level by majority vote of three copies
+Status decode_fec_parity_level(DecodeInfo *decInfo)
+{
+    char level[3];
+    if (decode_buffer_from_image(level, 3, decInfo) == e_failure)
+        return e_failure;
+
+    decInfo->fec_parity = (uchar)((level[0] & level[1]) | (level[0] & level[2]) | (level[1] & level[2]));
+    decInfo->encrypted = (decInfo->fec_parity & FEC_FLAG_ENCRYPTED) != 0;
+    decInfo->fec_parity &= ~FEC_FLAG_ENCRYPTED;
+    if (fec_init(&decInfo->fec, decInfo->fec_parity) == e_failure)
+    {
+        printf("ERROR: Invalid FEC parity level %d\n", decInfo->fec_parity);
+        return e_failure;
+    }
+    printf("FEC parity level decoded: %d symbols per codeword\n", decInfo->fec_parity);
+    return e_success;
+}
+
+// Function to decode a group of bytes and correct it with its parity
+static Status decode_fec_group(char *data, long size, DecodeInfo *decInfo)
+{
+    uchar parity[FEC_INTERLEAVE * FEC_MAX_PARITY];
+
+    if (decode_buffer_from_image(data, size, decInfo) == e_failure)
+        return e_failure;
+    if (decode_buffer_from_image((char *)parity, fec_group_parity_size(&decInfo->fec, size), decInfo) == e_failure)
+        return e_failure;
+
+    int fixed = fec_decode_group(&decInfo->fec, (uchar *)data, size, parity);
+    if (fixed < 0)
+    {
+        printf("ERROR: Too many corrupted bytes to correct\n");
+        return e_failure;
+    }
+    if (fixed > 0)
+        printf("Corrected %d corrupted bytes\n", fixed);
+    return e_success;
+}
+
+// Function to decode the FEC protected header (extension and file size)
+Status decode_fec_header(DecodeInfo *decInfo, long *file_size)
+{
+    uchar header[FEC_HEADER_SIZE];
+    int extn_size = 0;
+    long size = 0;
+
+    if (decode_fec_group((char *)header, FEC_HEADER_SIZE, decInfo) == e_failure)
+        return e_failure;
+
+    // Sizes are stored MSB first, the same bit order as decode_size_from_lsb
+    for (int i = 0; i < 4; i++)
+    {
+        extn_size = (extn_size << 8) | header[i];
+        size = (size << 8) | header[4 + FEC_EXTN_MAX + i];
+    }
+    if (extn_size < 0 || extn_size > FEC_EXTN_MAX)
+    {
+        printf("ERROR: Invalid file extension size %d\n", extn_size);
+        return e_failure;
+    }
+
+    memcpy(decInfo->file_extn, header + 4, extn_size);
+    decInfo->file_extn[extn_size] = '\0';
+    printf("File extension decoded: %s\n", decInfo->file_extn);
 
-    for (long i = 0; i < file_size; i++)
+    *file_size = size;
+    return e_success;
+}
+
+// Function to decode and correct FEC protected data one group at a time
+Status decode_fec_secret_file_data(DecodeInfo *decInfo, long file_size)
+{
+    char data[FEC_INTERLEAVE * FEC_CODEWORD_LEN];
+    long group = fec_group_data_size(&decInfo->fec);
+
+    while (file_size > 0)
     {
-        fread(image_buffer, 8, 1, decInfo->fptr_stego_image);
-        ch = decode_byte_from_lsb(image_buffer);
-        fputc(ch, decInfo->fptr_output);
+        long size = file_size < group ? file_size : group;
+        if (decode_fec_group(data, size, decInfo) == e_failure)
+            return e_failure;
+        if (decInfo->encrypted)
+            cipher_decrypt(&decInfo->cipher, (uchar *)data, size);
+        fwrite(data, size, 1, decInfo->fptr_output);
+        file_size -= size;
     }
 
     printf("Secret data decoded successfully\n");
     return e_success;
 }
 
+// Function to decode the salt and tag and start the cipher
+Status decode_cipher_header(DecodeInfo *decInfo)
+{
+    uchar header[CIPHER_HEADER_SIZE];
+    uchar key[CIPHER_KEY_SIZE];
+    Status status;
+
+    if (decInfo->fec_parity)
+        status = decode_fec_group((char *)header, CIPHER_HEADER_SIZE, decInfo);
+    else
+        status = decode_buffer_from_image((char *)header, CIPHER_HEADER_SIZE, decInfo);
+    if (status == e_failure)
+        return e_failure;
+
+    memcpy(decInfo->tag, header + CIPHER_SALT_SIZE, CIPHER_TAG_SIZE);
+
+    cipher_get_key(decInfo->key, decInfo->passphrase, header, key);
+    cipher_start(&decInfo->cipher, key, header, (const uchar *)decInfo->file_extn, strlen(decInfo->file_extn));
+    memset(key, 0, sizeof(key));
+    return e_success;
+}
+
+// Function to remove decrypted output that was never authenticated
+Status discard_decoded_output(DecodeInfo *decInfo)
+{
+    if (decInfo->encrypted)
+    {
+        fclose(decInfo->fptr_output);
+        remove(decInfo->output_fname);
+    }
+    return e_failure;
+}
+
 // Function to perform all decoding operations
 Status do_decoding(DecodeInfo *decInfo)
 {
@@ -145,20 +318,46 @@ Status do_decoding(DecodeInfo *decInfo)
     if (open_decode_files(decInfo) == e_failure)
         return e_failure;
 
-    // Skip BMP header
-    fseek(decInfo->fptr_stego_image, 54, SEEK_SET);
+    // Parse the image header and skip to the first pixel span
+    if (carrier_open(&decInfo->carrier, decInfo->stego_image_fname, decInfo->fptr_stego_image,
+                     decInfo->raw_width, decInfo->raw_height) == e_failure)
+        return e_failure;
+    carrier_skip_header(&decInfo->carrier);
 
     // Decode and verify magic string
     if (decode_magic_string(decInfo) == e_failure)
         return e_failure;
 
-    // Decode extension size and extension
-    int extn_size = decode_secret_file_extn_size(decInfo);
-    if (decode_secret_file_extn(decInfo, extn_size) == e_failure)
+    if (decInfo->encrypted && decInfo->key == NULL)
+    {
+        printf("ERROR: Stego image is encrypted, pass --key <hex key> or --passphrase <text>\n");
+        return e_failure;
+    }
+
+    // The data could not be authenticated, so do not let a given key suggest it was
+    if (!decInfo->encrypted && decInfo->key != NULL)
+    {
+        printf("ERROR: Stego image is not encrypted, so it cannot be checked with the given key\n");
         return e_failure;
+    }
+
+    // Decode extension size and extension (FEC header also carries the file size)
+    long file_size = 0;
+    if (decInfo->fec_parity)
+    {
+        if (decode_fec_header(decInfo, &file_size) == e_failure)
+            return e_failure;
+    }
+    else
+    {
+        int extn_size = decode_secret_file_extn_size(decInfo);
+        if (decode_secret_file_extn(decInfo, extn_size) == e_failure)
+            return e_failure;
+    }
 
     // Adjust output filename by removing incorrect extension and adding decoded one
-    char *dot = strrchr(decInfo->output_fname, '.');
+    char *base = strrchr(decInfo->output_fname, '/');
+    char *dot = strrchr(base ? base + 1 : decInfo->output_fname, '.');
     if (dot != NULL)
         *dot = '\0';
     strcat(decInfo->output_fname, decInfo->file_extn);
@@ -174,18 +373,40 @@ Status do_decoding(DecodeInfo *decInfo)
         return e_failure;
     }
 
-    // Decode file size and actual data
-    long file_size = decode_secret_file_size(decInfo);
+    // Decode file size (the FEC header already carried it)
+    if (!decInfo->fec_parity)
+        file_size = decode_secret_file_size(decInfo);
     printf("File size decoded: %ld bytes\n", file_size);
 
-    if (decode_secret_file_data(decInfo, file_size) == e_failure)
-        return e_failure;
+    // Salt and tag sit between the header and the data
+    if (decInfo->encrypted && decode_cipher_header(decInfo) == e_failure)
+        return discard_decoded_output(decInfo);
+
+    // Decode actual data
+    if (decInfo->fec_parity)
+    {
+        if (decode_fec_secret_file_data(decInfo, file_size) == e_failure)
+            return discard_decoded_output(decInfo);
+    }
+    else
+    {
+        if (decode_secret_file_data(decInfo, file_size) == e_failure)
+            return discard_decoded_output(decInfo);
+    }
+
+    // Reject the output on a wrong passphrase or modified data
+    if (decInfo->encrypted && cipher_verify(&decInfo->cipher, decInfo->tag) == e_failure)
+    {
+        printf("ERROR: Authentication failed (wrong key or modified data)\n");
+        return discard_decoded_output(decInfo);
+    }
 
     printf("Decoding completed successfully.\n");
 
     // Close open files
     fclose(decInfo->fptr_output);
     fclose(decInfo->fptr_stego_image);
+    carrier_close(&decInfo->carrier);
 
     return e_success;
 }
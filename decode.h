@@ -3,10 +3,16 @@
 
 #include <stdio.h>
 #include "types.h"
+#include "fec.h"
+#include "cipher.h"
+#include "carrier.h"
 
 // Magic string used to identify valid stego data
 #define MAGIC_STRING "#*"
 
+// Secret bytes extracted and decrypted per pass
+#define DECODE_CHUNK_SIZE 512
+
 // Structure to store all decoding-related information
 typedef struct _DecodeInfo
 {
@@ -14,7 +20,17 @@ typedef struct _DecodeInfo
     char output_fname[260];    // Name of the output file to store decoded data
     char file_extn[10];        // File extension of the hidden secret file
     FILE *fptr_stego_image;    // File pointer to the stego image
+    Carrier carrier;           // Image format and pixel spans of the stego image
+    uint raw_width;            // Width of raw RGB stego images
+    uint raw_height;           // Height of raw RGB stego images
     FILE *fptr_output;         // File pointer to the decoded output file
+    int fec_parity;            // Parity symbols per FEC codeword (0 = FEC off)
+    FecCodec fec;              // Reed-Solomon codec used when FEC is on
+    char *key;                 // Hex key or passphrase for encrypted data (NULL if none given)
+    int passphrase;            // Whether key is a passphrase to stretch
+    int encrypted;             // Whether the hidden data is encrypted
+    uchar tag[CIPHER_TAG_SIZE]; // Tag read from the stego header
+    CipherCtx cipher;          // ChaCha20-Poly1305 state
 } DecodeInfo;
 
 // Function to read and validate command-line arguments for decoding
@@ -44,6 +60,24 @@ long decode_secret_file_size(DecodeInfo *decInfo);
 // Function to decode and write secret data to the output file
 Status decode_secret_file_data(DecodeInfo *decInfo, long file_size);
 
+// Function to decode a buffer of bytes from image data
+Status decode_buffer_from_image(char *buffer, long size, DecodeInfo *decInfo);
+
+// Function to decode the FEC parity level by majority vote
+Status decode_fec_parity_level(DecodeInfo *decInfo);
+
+// Function to decode the FEC protected header (extension and file size)
+Status decode_fec_header(DecodeInfo *decInfo, long *file_size);
+
+// Function to decode and correct FEC protected secret data
+Status decode_fec_secret_file_data(DecodeInfo *decInfo, long file_size);
+
+// Function to decode the salt and tag and start the cipher
+Status decode_cipher_header(DecodeInfo *decInfo);
+
+// Function to remove decrypted output that was never authenticated
+Status discard_decoded_output(DecodeInfo *decInfo);
+
 // Function to perform the entire decoding process
 Status do_decoding(DecodeInfo *decInfo);
 
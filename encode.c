@@ -1,27 +1,12 @@
 #include <stdio.h>
 #include <string.h>
 #include "encode.h"
+#include "common.h"
+#include "fec.h"
+#include "cipher.h"
+#include "carrier.h"
 #include "types.h"
 
-// Function to get image size (width * height * 3 bytes per pixel)
-uint get_image_size_for_bmp(FILE *fptr_image)
-{
-    uint width, height;
-
-    // Move file pointer to 18th byte where width is stored
-    fseek(fptr_image, 18, SEEK_SET);
-
-    // Read width and height values from the BMP header
-    fread(&width, sizeof(int), 1, fptr_image);
-    fread(&height, sizeof(int), 1, fptr_image);
-
-    printf("width = %u\n", width);
-    printf("height = %u\n", height);
-
-    // Return total number of bytes available for pixel data
-    return width * height * 3;
-}
-
 // Function to find file size in bytes
 uint get_file_size(FILE *fptr)
 {
@@ -32,20 +17,30 @@ uint get_file_size(FILE *fptr)
     return size;
 }
 
+// Function to check the secret file type (.txt, .c, or .sh)
+Status validate_secret_fname(const char *fname)
+{
+    if (strstr(fname, ".txt") || strstr(fname, ".c") || strstr(fname, ".sh"))
+        return e_success;
+    else
+        return e_failure;
+}
+
 // Function to validate and store filenames from command-line arguments
 Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
 {
-    // Validate source image name (must be .bmp)
-    if (strstr(argv[2], ".bmp") != NULL)
+    // Validate source image name (must be a supported carrier format)
+    const CarrierCodec *codec = carrier_codec_for_file(argv[2]);
+    if (codec != NULL)
         encInfo->src_image_fname = argv[2];
     else
     {
-        printf("ERROR: Source image file must be a .bmp file\n");
+        printf("ERROR: Source image file must be a .bmp, .ppm, .pgm, .tif or .rgb file\n");
         return e_failure;
     }
 
     // Validate secret file type (.txt, .c, or .sh)
-    if (strstr(argv[3], ".txt") || strstr(argv[3], ".c") || strstr(argv[3], ".sh"))
+    if (validate_secret_fname(argv[3]) == e_success)
         encInfo->secret_fname = argv[3];
     else
     {
@@ -53,14 +48,18 @@ Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
         return e_failure;
     }
 
-    // Validate or assign default stego image filename
+    // Validate or assign default stego image filename (same format as the source)
     if (argv[4] == NULL)
-        encInfo->stego_image_fname = "default.bmp";
-    else if (strstr(argv[4], ".bmp"))
+    {
+        static char default_fname[32];
+        snprintf(default_fname, sizeof(default_fname), "default%s", strrchr(argv[2], '.'));
+        encInfo->stego_image_fname = default_fname;
+    }
+    else if (carrier_codec_for_file(argv[4]) == codec)
         encInfo->stego_image_fname = argv[4];
     else
     {
-        printf("ERROR: Output file must be a .bmp file\n");
+        printf("ERROR: Output file must be a %s file like the source image\n", codec->name);
         return e_failure;
     }
 
@@ -97,32 +96,66 @@ Status open_files(EncodeInfo *encInfo)
     return e_success;
 }
 
-// Function to verify if image has enough capacity to hide data
-Status check_capacity(EncodeInfo *encInfo)
+// Function to get the secret file extension from the file name, ignoring dots in directories
+const char *get_secret_extn(const char *fname)
 {
-    encInfo->image_capacity = get_image_size_for_bmp(encInfo->fptr_src_image);
-    encInfo->size_secret_file = get_file_size(encInfo->fptr_secret);
+    const char *base = strrchr(fname, '/');
+    const char *extn = strrchr(base ? base + 1 : fname, '.');
+    return extn ? extn : "";
+}
 
-    // Ensure image can hold all required data (header + secret + metadata)
-    if (encInfo->image_capacity > (16 + 32 + 32 + 32 + (encInfo->size_secret_file * 8)))
-        return e_success;
-    else
-        return e_failure;
+// Function to get the image bytes needed to hide a secret file, or -1 if it cannot be hidden
+long get_required_capacity(long secret_size, int extn_size, int fec_parity, int encrypted)
+{
+    // FEC data: magic + parity level + protected header + protected salt and tag + protected secret
+    if (fec_parity)
+    {
+        FecCodec fec;
+        if (extn_size > FEC_EXTN_MAX || fec_init(&fec, fec_parity) == e_failure)
+            return -1;
+
+        long fec_bytes = 3 + fec_encoded_size(&fec, FEC_HEADER_SIZE) + fec_encoded_size(&fec, secret_size);
+        if (encrypted)
+            fec_bytes += fec_encoded_size(&fec, CIPHER_HEADER_SIZE);
+        return 16 + fec_bytes * 8;
+    }
+
+    // Magic + extension size + extension + file size + salt and tag + secret
+    return 16 + 32 + extn_size * 8 + 32 + (encrypted ? CIPHER_HEADER_SIZE * 8 : 0) + secret_size * 8;
 }
 
-// Function to copy the BMP header (first 54 bytes)
-Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image)
+// Function to verify if image has enough capacity to hide data
+Status check_capacity(EncodeInfo *encInfo)
 {
-    rewind(fptr_src_image);  // Reset pointer to start of BMP
+    if (carrier_open(&encInfo->src_carrier, encInfo->src_image_fname, encInfo->fptr_src_image,
+                     encInfo->raw_width, encInfo->raw_height) == e_failure)
+        return e_failure;
 
-    char imageBuffer[54];    // Buffer for header data
-    fread(imageBuffer, 54, 1, fptr_src_image);
-    fwrite(imageBuffer, 54, 1, fptr_dest_image);
+    printf("width = %u\n", encInfo->src_carrier.width);
+    printf("height = %u\n", encInfo->src_carrier.height);
 
-    if (ftell(fptr_src_image) == ftell(fptr_dest_image))
-        return e_success;
-    else
+    encInfo->image_capacity = carrier_capacity(&encInfo->src_carrier);
+    encInfo->size_secret_file = get_file_size(encInfo->fptr_secret);
+
+    if (encInfo->fec_parity && fec_init(&encInfo->fec, encInfo->fec_parity) == e_failure)
         return e_failure;
+
+    // Ensure image can hold all required data (header + secret + metadata)
+    int extn_size = strlen(get_secret_extn(encInfo->secret_fname));
+    long required = get_required_capacity(encInfo->size_secret_file, extn_size,
+                                          encInfo->fec_parity, encInfo->key != NULL);
+    if (required < 0)
+    {
+        printf("ERROR: Secret file extension is too long for the FEC header (%d bytes, at most %d)\n",
+               extn_size, FEC_EXTN_MAX);
+        return e_failure;
+    }
+    if (encInfo->image_capacity > required)
+        return e_success;
+
+    printf("ERROR: Image can hold %u bytes of hidden data, %ld are needed\n",
+           encInfo->image_capacity / 8, (required + 7) / 8);
+    return e_failure;
 }
 
 // Function to encode a predefined magic string into image
@@ -132,9 +165,9 @@ Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo)
 
     for (int i = 0; i < strlen(magic_string); i++)
     {
-        fread(imageBuffer, 8, 1, encInfo->fptr_src_image);          // Read 8 bytes from image
-        encode_byte_to_lsb(magic_string[i], imageBuffer);           // Encode one character
-        fwrite(imageBuffer, 8, 1, encInfo->fptr_stego_image);       // Write modified bytes
+        carrier_read_pixels(&encInfo->src_carrier, imageBuffer, 8);                                 // Read 8 bytes from image
+        encode_byte_to_lsb(magic_string[i], imageBuffer);                                           // Encode one character
+        carrier_write_pixels(&encInfo->src_carrier, imageBuffer, 8, encInfo->fptr_stego_image);     // Write modified bytes
     }
 
     if (ftell(encInfo->fptr_src_image) == ftell(encInfo->fptr_stego_image))
@@ -147,9 +180,9 @@ Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo)
 Status encode_secret_file_extn_size(int size, EncodeInfo *encInfo)
 {
     char imageBuffer[32];
-    fread(imageBuffer, 32, 1, encInfo->fptr_src_image);
+    carrier_read_pixels(&encInfo->src_carrier, imageBuffer, 32);
     encode_size_to_lsb(size, imageBuffer);
-    fwrite(imageBuffer, 32, 1, encInfo->fptr_stego_image);
+    carrier_write_pixels(&encInfo->src_carrier, imageBuffer, 32, encInfo->fptr_stego_image);
 
     if (ftell(encInfo->fptr_src_image) == ftell(encInfo->fptr_stego_image))
         return e_success;
@@ -163,9 +196,9 @@ Status encode_secret_file_extn(const char *file_extn, EncodeInfo *encInfo)
     char imageBuffer[8];
     for (int i = 0; i < strlen(file_extn); i++)
     {
-        fread(imageBuffer, 8, 1, encInfo->fptr_src_image);
+        carrier_read_pixels(&encInfo->src_carrier, imageBuffer, 8);
         encode_byte_to_lsb(file_extn[i], imageBuffer);
-        fwrite(imageBuffer, 8, 1, encInfo->fptr_stego_image);
+        carrier_write_pixels(&encInfo->src_carrier, imageBuffer, 8, encInfo->fptr_stego_image);
     }
 
     if (ftell(encInfo->fptr_src_image) == ftell(encInfo->fptr_stego_image))
@@ -178,9 +211,9 @@ Status encode_secret_file_extn(const char *file_extn, EncodeInfo *encInfo)
 Status encode_secret_file_size(long file_size, EncodeInfo *encInfo)
 {
     char imageBuffer[32];
-    fread(imageBuffer, 32, 1, encInfo->fptr_src_image);
+    carrier_read_pixels(&encInfo->src_carrier, imageBuffer, 32);
     encode_size_to_lsb(file_size, imageBuffer);
-    fwrite(imageBuffer, 32, 1, encInfo->fptr_stego_image);
+    carrier_write_pixels(&encInfo->src_carrier, imageBuffer, 32, encInfo->fptr_stego_image);
 
     if (ftell(encInfo->fptr_src_image) == ftell(encInfo->fptr_stego_image))
         return e_success;
@@ -188,21 +221,187 @@ Status encode_secret_file_size(long file_size, EncodeInfo *encInfo)
         return e_failure;
 }
 
-// Function to encode secret file data byte-by-byte
+// Function to encode secret file data, encrypting each chunk in the same pass
 Status encode_secret_file_data(EncodeInfo *encInfo)
 {
-    char secret_data[encInfo->size_secret_file];   // Buffer to hold entire secret file
+    char secret_data[ENCODE_CHUNK_SIZE];
+    long remaining = encInfo->size_secret_file;
+
     rewind(encInfo->fptr_secret);                  // Reset secret file pointer
-    fread(secret_data, encInfo->size_secret_file, 1, encInfo->fptr_secret);
+    while (remaining > 0)
+    {
+        long size = remaining < ENCODE_CHUNK_SIZE ? remaining : ENCODE_CHUNK_SIZE;
+        if (fread(secret_data, size, 1, encInfo->fptr_secret) != 1)
+            return e_failure;
 
-    char imageBuffer[8];
-    for (int i = 0; i < encInfo->size_secret_file; i++)
+        // Keystream XOR runs on the chunk while it is still in cache for embedding
+        if (encInfo->key)
+            cipher_encrypt(&encInfo->cipher, (uchar *)secret_data, size);
+
+        if (encode_buffer_to_image(secret_data, size, encInfo) == e_failure)
+            return e_failure;
+        remaining -= size;
+    }
+    return e_success;
+}
+
+// Function to encode a buffer of bytes into image data, 8 image bytes per byte
+Status encode_buffer_to_image(const char *buffer, long size, EncodeInfo *encInfo)
+{
+    char imageBuffer[ENCODE_CHUNK_SIZE * 8];
+    while (size > 0)
+    {
+        long n = size < ENCODE_CHUNK_SIZE ? size : ENCODE_CHUNK_SIZE;
+        if (carrier_read_pixels(&encInfo->src_carrier, imageBuffer, 8 * n) == e_failure)
+            return e_failure;
+        for (long i = 0; i < n; i++)
+            encode_byte_to_lsb(buffer[i], imageBuffer + 8 * i);
+        if (carrier_write_pixels(&encInfo->src_carrier, imageBuffer, 8 * n, encInfo->fptr_stego_image) == e_failure)
+            return e_failure;
+
+        buffer += n;
+        size -= n;
+    }
+
+    if (ftell(encInfo->fptr_src_image) == ftell(encInfo->fptr_stego_image))
+        return e_success;
+    else
+        return e_failure;
+}
+
+// Function to encode the FEC parity level three times for a majority vote
+Status encode_fec_parity_level(int nparity, EncodeInfo *encInfo)
+{
+    char level[3] = {nparity, nparity, nparity};
+    return encode_buffer_to_image(level, 3, encInfo);
+}
+
+// Function to encode a group of bytes followed by its Reed-Solomon parity
+static Status encode_fec_group(const char *data, long size, EncodeInfo *encInfo)
+{
+    uchar parity[FEC_INTERLEAVE * FEC_MAX_PARITY];
+
+    if (fec_encode_group(&encInfo->fec, (const uchar *)data, size, parity) == e_failure)
+        return e_failure;
+    if (encode_buffer_to_image(data, size, encInfo) == e_failure)
+        return e_failure;
+    return encode_buffer_to_image((const char *)parity,
+                                  fec_group_parity_size(&encInfo->fec, size), encInfo);
+}
+
+// Function to encode the extension and file size as one protected codeword
+Status encode_fec_header(const char *file_extn, long file_size, EncodeInfo *encInfo)
+{
+    char header[FEC_HEADER_SIZE] = {0};
+    int extn_size = strlen(file_extn);
+
+    if (extn_size > FEC_EXTN_MAX)
     {
-        fread(imageBuffer, 8, 1, encInfo->fptr_src_image);          // Read 8 image bytes
-        encode_byte_to_lsb(secret_data[i], imageBuffer);            // Encode 1 byte of secret data
-        fwrite(imageBuffer, 8, 1, encInfo->fptr_stego_image);       // Write modified image bytes
+        printf("ERROR: File extension too long for FEC header\n");
+        return e_failure;
     }
 
+    // Sizes are stored MSB first, the same bit order as encode_size_to_lsb
+    for (int i = 0; i < 4; i++)
+    {
+        header[i] = extn_size >> (24 - 8 * i);
+        header[4 + FEC_EXTN_MAX + i] = file_size >> (24 - 8 * i);
+    }
+    memcpy(header + 4, file_extn, extn_size);
+
+    return encode_fec_group(header, FEC_HEADER_SIZE, encInfo);
+}
+
+// Function to encode secret file data one interleaved FEC group at a time
+Status encode_fec_secret_file_data(EncodeInfo *encInfo)
+{
+    char data[FEC_INTERLEAVE * FEC_CODEWORD_LEN];
+    long group = fec_group_data_size(&encInfo->fec);
+    long remaining = encInfo->size_secret_file;
+
+    rewind(encInfo->fptr_secret);
+    while (remaining > 0)
+    {
+        long size = remaining < group ? remaining : group;
+        if (fread(data, size, 1, encInfo->fptr_secret) != 1)
+            return e_failure;
+        if (encInfo->key)
+            cipher_encrypt(&encInfo->cipher, (uchar *)data, size);
+        if (encode_fec_group(data, size, encInfo) == e_failure)
+            return e_failure;
+        remaining -= size;
+    }
+    return e_success;
+}
+
+// Function to get the key and start the cipher for the secret file
+Status start_encryption(const char *file_extn, EncodeInfo *encInfo)
+{
+    uchar key[CIPHER_KEY_SIZE];
+
+    if (cipher_random_salt(encInfo->salt) == e_failure)
+        return e_failure;
+    cipher_get_key(encInfo->key, encInfo->passphrase, encInfo->salt, key);
+
+    // The extension is authenticated as well; the size is part of the tag itself
+    cipher_start(&encInfo->cipher, key, encInfo->salt, (const uchar *)file_extn, strlen(file_extn));
+    memset(key, 0, sizeof(key));
+    return e_success;
+}
+
+// Function to reserve image bytes for the salt and tag, known only after the data
+Status reserve_cipher_header(EncodeInfo *encInfo)
+{
+    long size = CIPHER_HEADER_SIZE;
+    if (encInfo->fec_parity)
+        size = fec_encoded_size(&encInfo->fec, CIPHER_HEADER_SIZE);
+
+    // Keep the original pixel bytes and where they go so encode_cipher_header can rewrite them
+    encInfo->cipher_slot_pos = ftell(encInfo->fptr_stego_image);
+    encInfo->cipher_slot_cursor = encInfo->src_carrier.wr;
+    encInfo->cipher_slot_size = size * 8;
+    if (carrier_read_pixels(&encInfo->src_carrier, encInfo->cipher_slot, encInfo->cipher_slot_size) == e_failure)
+        return e_failure;
+    if (carrier_write_pixels(&encInfo->src_carrier, encInfo->cipher_slot, encInfo->cipher_slot_size,
+                             encInfo->fptr_stego_image) == e_failure)
+        return e_failure;
+
+    if (ftell(encInfo->fptr_src_image) == ftell(encInfo->fptr_stego_image))
+        return e_success;
+    else
+        return e_failure;
+}
+
+// Function to encode salt and tag into the reserved image bytes
+Status encode_cipher_header(EncodeInfo *encInfo)
+{
+    char header[CIPHER_HEADER_SIZE + FEC_MAX_PARITY];
+    long size = CIPHER_HEADER_SIZE;
+    long end = ftell(encInfo->fptr_stego_image);
+
+    memcpy(header, encInfo->salt, CIPHER_SALT_SIZE);
+    cipher_finish(&encInfo->cipher, (uchar *)header + CIPHER_SALT_SIZE);
+
+    if (encInfo->fec_parity)
+    {
+        fec_encode_group(&encInfo->fec, (const uchar *)header, CIPHER_HEADER_SIZE,
+                         (uchar *)header + CIPHER_HEADER_SIZE);
+        size += fec_group_parity_size(&encInfo->fec, CIPHER_HEADER_SIZE);
+    }
+
+    for (long i = 0; i < size; i++)
+        encode_byte_to_lsb(header[i], encInfo->cipher_slot + 8 * i);
+
+    CarrierCursor cursor = encInfo->src_carrier.wr;
+    encInfo->src_carrier.wr = encInfo->cipher_slot_cursor;
+    fseek(encInfo->fptr_stego_image, encInfo->cipher_slot_pos, SEEK_SET);
+    Status status = carrier_write_pixels(&encInfo->src_carrier, encInfo->cipher_slot, encInfo->cipher_slot_size,
+                                         encInfo->fptr_stego_image);
+    encInfo->src_carrier.wr = cursor;
+    fseek(encInfo->fptr_stego_image, end, SEEK_SET);
+    if (status == e_failure)
+        return e_failure;
+
     if (ftell(encInfo->fptr_src_image) == ftell(encInfo->fptr_stego_image))
         return e_success;
     else
@@ -255,35 +454,89 @@ Status do_encoding(EncodeInfo *encInfo)
 
     printf("Checking capacity\n");
     if (check_capacity(encInfo) == e_failure)
+    {
+        // Nothing was written yet, so do not leave an empty stego image behind
+        fclose(encInfo->fptr_stego_image);
+        remove(encInfo->stego_image_fname);
         return e_failure;
+    }
 
-    printf("Copying BMP header\n");
-    if (copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure)
-        return e_failure;
-
-    printf("Encoding magic string\n");
-    if (encode_magic_string(MAGIC_STRING, encInfo) == e_failure)
+    printf("Copying image header\n");
+    if (carrier_write_header(&encInfo->src_carrier, encInfo->fptr_stego_image) == e_failure)
         return e_failure;
 
     // Get the secret file extension (e.g., .txt, .c, .sh)
-    char *extn = strstr(encInfo->secret_fname, ".");
+    const char *extn = get_secret_extn(encInfo->secret_fname);
     int extn_size = strlen(extn);
 
-    printf("Encoding file extension size\n");
-    encode_secret_file_extn_size(extn_size, encInfo);
+    if (encInfo->key)
+    {
+        printf(encInfo->passphrase ? "Deriving encryption key from passphrase\n" : "Starting encryption\n");
+        if (start_encryption(extn, encInfo) == e_failure)
+            return e_failure;
+    }
 
-    printf("Encoding file extension\n");
-    encode_secret_file_extn(extn, encInfo);
+    if (encInfo->fec_parity)
+    {
+        printf("Encoding FEC magic string\n");
+        if (encode_magic_string(MAGIC_STRING_FEC, encInfo) == e_failure)
+            return e_failure;
 
-    printf("Encoding secret file size\n");
-    encode_secret_file_size(encInfo->size_secret_file, encInfo);
+        printf("Encoding FEC parity level (%d symbols per codeword)\n", encInfo->fec_parity);
+        if (encode_fec_parity_level(encInfo->fec_parity | (encInfo->key ? FEC_FLAG_ENCRYPTED : 0), encInfo) == e_failure)
+            return e_failure;
 
-    printf("Encoding secret file data\n");
-    encode_secret_file_data(encInfo);
+        printf("Encoding FEC protected header\n");
+        if (encode_fec_header(extn, encInfo->size_secret_file, encInfo) == e_failure)
+            return e_failure;
+    }
+    else
+    {
+        printf("Encoding magic string\n");
+        if (encode_magic_string(encInfo->key ? MAGIC_STRING_CRYPT : MAGIC_STRING, encInfo) == e_failure)
+            return e_failure;
+
+        printf("Encoding file extension size\n");
+        encode_secret_file_extn_size(extn_size, encInfo);
+
+        printf("Encoding file extension\n");
+        encode_secret_file_extn(extn, encInfo);
+
+        printf("Encoding secret file size\n");
+        encode_secret_file_size(encInfo->size_secret_file, encInfo);
+    }
+
+    if (encInfo->key)
+    {
+        printf("Reserving space for salt and tag\n");
+        if (reserve_cipher_header(encInfo) == e_failure)
+            return e_failure;
+    }
+
+    if (encInfo->fec_parity)
+    {
+        printf("Encoding FEC protected secret file data\n");
+        if (encode_fec_secret_file_data(encInfo) == e_failure)
+            return e_failure;
+    }
+    else
+    {
+        printf("Encoding secret file data\n");
+        if (encode_secret_file_data(encInfo) == e_failure)
+            return e_failure;
+    }
+
+    if (encInfo->key)
+    {
+        printf("Encoding salt and tag\n");
+        if (encode_cipher_header(encInfo) == e_failure)
+            return e_failure;
+    }
 
     printf("Copying remaining image data\n");
     copy_remaining_img_data(encInfo->fptr_src_image, encInfo->fptr_stego_image);
 
+    carrier_close(&encInfo->src_carrier);
     printf("Encoding complete! Stego image saved as %s\n", encInfo->stego_image_fname);
     return e_success;
 }
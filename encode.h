@@ -2,7 +2,13 @@
 #define ENCODE_H
 #include <stdio.h>
 #include "types.h" // Contains user defined types
+#include "fec.h"   // Reed-Solomon forward error correction
+#include "cipher.h" // ChaCha20-Poly1305 encryption
+#include "carrier.h" // Image format codecs
 #define MAGIC_STRING "#*"
+
+// Secret bytes read, encrypted and embedded per pass (fits in L1 with its image bytes)
+#define ENCODE_CHUNK_SIZE 512
 /*
  * Structure to store information required for
  * encoding secret file to source Image
@@ -16,6 +22,9 @@ typedef struct _EncodeInfo
     char *src_image_fname; // To store the src image name
     FILE *fptr_src_image;  // To store the address of the src image
     uint image_capacity;   // To store the size of image
+    Carrier src_carrier;   // To store the image format and pixel spans
+    uint raw_width;        // To store the width of raw RGB images
+    uint raw_height;       // To store the height of raw RGB images
     /* Secret File Info */
     char *secret_fname;       // To store the secret file name
     FILE *fptr_secret;        // To store the secret file address
@@ -25,6 +34,18 @@ typedef struct _EncodeInfo
     /* Stego Image Info */
     char *stego_image_fname; // To store the dest file name
     FILE *fptr_stego_image;  // To store the address of stego image
+    /* Error Correction Info */
+    int fec_parity;          // Parity symbols per FEC codeword (0 = FEC off)
+    FecCodec fec;            // Reed-Solomon codec used when FEC is on
+    /* Encryption Info */
+    char *key;                     // Hex key or passphrase (NULL = encryption off)
+    int passphrase;                // Whether key is a passphrase to stretch
+    uchar salt[CIPHER_SALT_SIZE];  // Random salt stored in the stego header
+    CipherCtx cipher;              // ChaCha20-Poly1305 state
+    long cipher_slot_pos;          // Stego image offset of the salt and tag
+    CarrierCursor cipher_slot_cursor; // Pixel span position of the salt and tag
+    long cipher_slot_size;         // Image bytes holding the salt and tag
+    char cipher_slot[(CIPHER_HEADER_SIZE + FEC_MAX_PARITY) * 8]; // Copy of those image bytes
 
 } EncodeInfo;
 
@@ -33,6 +54,15 @@ typedef struct _EncodeInfo
 /* Read and validate Encode args from argv */
 Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo);
 
+/* Check secret file type */
+Status validate_secret_fname(const char *fname);
+
+/* Get the secret file extension from its base name */
+const char *get_secret_extn(const char *fname);
+
+/* Get image bytes needed to hide a secret file (-1 if it cannot be hidden) */
+long get_required_capacity(long secret_size, int extn_size, int fec_parity, int encrypted);
+
 /* Perform the encoding */
 Status do_encoding(EncodeInfo *encInfo);
 
@@ -42,15 +72,9 @@ Status open_files(EncodeInfo *encInfo);
 /* check capacity */
 Status check_capacity(EncodeInfo *encInfo);
 
-/* Get image size */
-uint get_image_size_for_bmp(FILE *fptr_image);
-
 /* Get file size */
 uint get_file_size(FILE *fptr);
 
-/* Copy bmp image header */
-Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image);
-
 /* Store Magic String */
 Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo);
 
@@ -66,6 +90,27 @@ Status encode_secret_file_size(long file_size, EncodeInfo *encInfo);
 /* Encode secret file data*/
 Status encode_secret_file_data(EncodeInfo *encInfo);
 
+/* Encode a buffer of bytes into image data */
+Status encode_buffer_to_image(const char *buffer, long size, EncodeInfo *encInfo);
+
+/* Encode FEC parity level (repeated for a majority vote) */
+Status encode_fec_parity_level(int nparity, EncodeInfo *encInfo);
+
+/* Encode FEC protected header (extension and secret file size) */
+Status encode_fec_header(const char *file_extn, long file_size, EncodeInfo *encInfo);
+
+/* Encode FEC protected secret file data */
+Status encode_fec_secret_file_data(EncodeInfo *encInfo);
+
+/* Get the key and start the cipher for the secret file */
+Status start_encryption(const char *file_extn, EncodeInfo *encInfo);
+
+/* Reserve image bytes for the salt and tag, known only after the data */
+Status reserve_cipher_header(EncodeInfo *encInfo);
+
+/* Encode salt and tag into the reserved image bytes */
+Status encode_cipher_header(EncodeInfo *encInfo);
+
 /* Encode a byte into LSB of image data array */
 Status encode_byte_to_lsb(char data, char *image_buffer);
 
@@ -0,0 +1,364 @@
+#include <string.h>
+#include "fec.h"
+#include "types.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define FEC_HAVE_SSSE3 1
+#endif
+
+// Primitive polynomial x^8 + x^4 + x^3 + x^2 + 1 used to build GF(256)
+#define GF_POLY 0x11D
+
+static uchar gf_exp[512];              // Antilog table, doubled to skip a modulo
+static uchar gf_log[256];              // Log table, gf_log[0] is unused
+static uchar gf_nibble[256][2][16];    // Per-constant products of low and high nibbles
+static int gf_ready = 0;
+
+// Region multiply in use: dst = c * src, or dst ^= c * src when add is set
+static void (*gf_region_mul)(uchar *dst, const uchar *src, uchar c, long n, int add);
+
+// Function to multiply two field elements
+static uchar gf_mul(uchar a, uchar b)
+{
+    if (a == 0 || b == 0)
+        return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+// Function to divide two field elements (b must be non-zero)
+static uchar gf_div(uchar a, uchar b)
+{
+    if (a == 0)
+        return 0;
+    return gf_exp[gf_log[a] + 255 - gf_log[b]];
+}
+
+// Function to multiply a region by a constant using the nibble tables
+static void gf_region_mul_scalar(uchar *dst, const uchar *src, uchar c, long n, int add)
+{
+    const uchar *lo = gf_nibble[c][0];
+    const uchar *hi = gf_nibble[c][1];
+
+    for (long i = 0; i < n; i++)
+    {
+        uchar p = lo[src[i] & 0x0F] ^ hi[src[i] >> 4];
+        dst[i] = add ? (dst[i] ^ p) : p;
+    }
+}
+
+#ifdef FEC_HAVE_SSSE3
+// Function to multiply a region by a constant, 16 bytes per pshufb pair
+__attribute__((target("ssse3")))
+static void gf_region_mul_ssse3(uchar *dst, const uchar *src, uchar c, long n, int add)
+{
+    __m128i lo = _mm_loadu_si128((const __m128i *)gf_nibble[c][0]);
+    __m128i hi = _mm_loadu_si128((const __m128i *)gf_nibble[c][1]);
+    __m128i mask = _mm_set1_epi8(0x0F);
+    long i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(x, mask)),
+                                  _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+        if (add)
+            p = _mm_xor_si128(p, _mm_loadu_si128((const __m128i *)(dst + i)));
+        _mm_storeu_si128((__m128i *)(dst + i), p);
+    }
+    gf_region_mul_scalar(dst + i, src + i, c, n - i, add);
+}
+#endif
+
+// Function to build the log/antilog and nibble tables once
+static void gf_init_tables(void)
+{
+    int x = 1;
+
+    if (gf_ready)
+        return;
+
+    for (int i = 0; i < 255; i++)
+    {
+        gf_exp[i] = x;
+        gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100)
+            x ^= GF_POLY;
+    }
+    for (int i = 255; i < 512; i++)
+        gf_exp[i] = gf_exp[i - 255];
+
+    for (int c = 0; c < 256; c++)
+    {
+        for (int v = 0; v < 16; v++)
+        {
+            gf_nibble[c][0][v] = gf_mul(c, v);
+            gf_nibble[c][1][v] = gf_mul(c, v << 4);
+        }
+    }
+
+    gf_region_mul = gf_region_mul_scalar;
+#ifdef FEC_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3"))
+        gf_region_mul = gf_region_mul_ssse3;
+#endif
+    gf_ready = 1;
+}
+
+// Function to initialise the codec for the given number of parity symbols
+Status fec_init(FecCodec *fec, int nparity)
+{
+    if (nparity < FEC_MIN_PARITY || nparity > FEC_MAX_PARITY)
+        return e_failure;
+
+    gf_init_tables();
+
+    fec->nparity = nparity;
+    fec->data_per_cw = FEC_CODEWORD_LEN - nparity;
+
+    // Build gen(x) = (x - a^0)(x - a^1)...(x - a^(nparity-1))
+    memset(fec->gen, 0, sizeof(fec->gen));
+    fec->gen[0] = 1;
+    for (int i = 0; i < nparity; i++)
+    {
+        for (int j = i + 1; j > 0; j--)
+            fec->gen[j] = fec->gen[j - 1] ^ gf_mul(fec->gen[j], gf_exp[i]);
+        fec->gen[0] = gf_mul(fec->gen[0], gf_exp[i]);
+    }
+    return e_success;
+}
+
+// Function to get the maximum data bytes carried by one interleaved group
+long fec_group_data_size(const FecCodec *fec)
+{
+    return (long)FEC_INTERLEAVE * fec->data_per_cw;
+}
+
+// Function to get the number of codewords used by a group of len bytes
+static int fec_group_codewords(const FecCodec *fec, long len)
+{
+    return (len + fec->data_per_cw - 1) / fec->data_per_cw;
+}
+
+// Function to get the parity bytes added to a group carrying len data bytes
+long fec_group_parity_size(const FecCodec *fec, long len)
+{
+    return (long)fec_group_codewords(fec, len) * fec->nparity;
+}
+
+// Function to get the total protected size of a len byte stream
+long fec_encoded_size(const FecCodec *fec, long len)
+{
+    long group = fec_group_data_size(fec);
+    long size = len + (len / group) * FEC_INTERLEAVE * fec->nparity;
+
+    if (len % group)
+        size += fec_group_parity_size(fec, len % group);
+    return size;
+}
+
+/*
+ * Function to run the parity LFSR of all codewords in a group at once.
+ * Row s holds symbol s of every codeword, so each step is one region
+ * multiply per generator coefficient across the interleaved codewords.
+ * The short final row is padded with zeros on both sides of the channel.
+ */
+static void fec_compute_parity(const FecCodec *fec, const uchar *data, long len,
+                               int ncw, uchar reg[][FEC_INTERLEAVE])
+{
+    int np = fec->nparity;
+    long rows = (len + ncw - 1) / ncw;
+    uchar row[FEC_INTERLEAVE];
+    uchar fb[FEC_INTERLEAVE];
+
+    memset(reg, 0, (size_t)np * FEC_INTERLEAVE);
+
+    for (long s = 0; s < rows; s++)
+    {
+        long avail = len - s * ncw;
+
+        memset(row, 0, sizeof(row));
+        memcpy(row, data + s * ncw, avail < ncw ? avail : ncw);
+
+        for (int j = 0; j < ncw; j++)
+            fb[j] = row[j] ^ reg[np - 1][j];
+
+        for (int k = np - 1; k > 0; k--)
+        {
+            memcpy(reg[k], reg[k - 1], ncw);
+            gf_region_mul(reg[k], fb, fec->gen[k], ncw, 1);
+        }
+        gf_region_mul(reg[0], fb, fec->gen[0], ncw, 0);
+    }
+}
+
+// Function to compute the parity of one group of len data bytes
+Status fec_encode_group(const FecCodec *fec, const uchar *data, long len, uchar *parity)
+{
+    uchar reg[FEC_MAX_PARITY][FEC_INTERLEAVE];
+    int ncw = fec_group_codewords(fec, len);
+    int np = fec->nparity;
+
+    if (len <= 0 || len > fec_group_data_size(fec))
+        return e_failure;
+
+    fec_compute_parity(fec, data, len, ncw, reg);
+
+    // Highest degree parity symbol goes first, interleaved like the data
+    for (int p = 0; p < np; p++)
+        memcpy(parity + (long)p * ncw, reg[np - 1 - p], ncw);
+    return e_success;
+}
+
+/*
+ * Function to correct a single codeword of n symbols (highest degree
+ * first) using Berlekamp-Massey, a Chien search and Forney's formula.
+ * Returns the number of corrected symbols, or -1 if uncorrectable.
+ */
+static int fec_correct_codeword(const FecCodec *fec, uchar *cw, int n)
+{
+    int np = fec->nparity;
+    uchar synd[FEC_MAX_PARITY];
+    uchar lambda[FEC_MAX_PARITY + 1] = {1};
+    uchar prev[FEC_MAX_PARITY + 1] = {1};
+    uchar tmp[FEC_MAX_PARITY + 1];
+    uchar omega[FEC_MAX_PARITY];
+    int err_deg[FEC_MAX_PARITY];
+    int nerr = 0, order = 0, shift = 1;
+    uchar last = 1;
+    int clean = 1;
+
+    // Syndromes S_i = c(a^i)
+    for (int i = 0; i < np; i++)
+    {
+        uchar s = 0;
+        for (int k = 0; k < n; k++)
+            s = gf_mul(s, gf_exp[i]) ^ cw[k];
+        synd[i] = s;
+        if (s)
+            clean = 0;
+    }
+    if (clean)
+        return 0;
+
+    // Berlekamp-Massey for the error locator polynomial
+    for (int r = 0; r < np; r++)
+    {
+        uchar d = synd[r];
+        for (int i = 1; i <= order; i++)
+            d ^= gf_mul(lambda[i], synd[r - i]);
+
+        if (d == 0)
+        {
+            shift++;
+            continue;
+        }
+
+        uchar scale = gf_div(d, last);
+        memcpy(tmp, lambda, sizeof(tmp));
+        for (int i = 0; i + shift <= np; i++)
+            lambda[i + shift] ^= gf_mul(scale, prev[i]);
+
+        if (2 * order <= r)
+        {
+            order = r + 1 - order;
+            memcpy(prev, tmp, sizeof(prev));
+            last = d;
+            shift = 1;
+        }
+        else
+            shift++;
+    }
+    if (order > np / 2)
+        return -1;
+
+    // Chien search: degree e is in error when lambda(a^-e) == 0
+    for (int e = 0; e < n && nerr <= order; e++)
+    {
+        uchar x_inv = gf_exp[(255 - e) % 255];
+        uchar v = 0;
+        for (int i = order; i >= 0; i--)
+            v = gf_mul(v, x_inv) ^ lambda[i];
+        if (v == 0)
+            err_deg[nerr++] = e;
+    }
+    if (nerr != order)
+        return -1;
+
+    // Error evaluator omega(x) = S(x) * lambda(x) mod x^np
+    for (int i = 0; i < np; i++)
+    {
+        omega[i] = 0;
+        for (int j = 0; j <= i && j <= order; j++)
+            omega[i] ^= gf_mul(lambda[j], synd[i - j]);
+    }
+
+    // Forney: magnitude = X * omega(X^-1) / lambda'(X^-1)
+    for (int k = 0; k < nerr; k++)
+    {
+        uchar x = gf_exp[err_deg[k]];
+        uchar x_inv = gf_exp[(255 - err_deg[k]) % 255];
+        uchar num = 0, den = 0;
+
+        for (int i = np - 1; i >= 0; i--)
+            num = gf_mul(num, x_inv) ^ omega[i];
+        for (int i = 1; i <= order; i += 2)
+            den ^= gf_mul(lambda[i], gf_exp[(gf_log[x_inv] * (i - 1)) % 255]);
+        if (den == 0)
+            return -1;
+
+        cw[n - 1 - err_deg[k]] ^= gf_mul(x, gf_div(num, den));
+    }
+    return nerr;
+}
+
+// Function to correct one group in place, returns corrected symbols or -1
+int fec_decode_group(const FecCodec *fec, uchar *data, long len, uchar *parity)
+{
+    uchar reg[FEC_MAX_PARITY][FEC_INTERLEAVE];
+    uchar cw[FEC_CODEWORD_LEN];
+    int ncw = fec_group_codewords(fec, len);
+    int np = fec->nparity;
+    long rows = (len + ncw - 1) / ncw;
+    int fixed = 0;
+
+    if (len <= 0 || len > fec_group_data_size(fec))
+        return -1;
+
+    // Re-encode the received data; codewords whose parity matches are clean
+    fec_compute_parity(fec, data, len, ncw, reg);
+
+    for (int j = 0; j < ncw; j++)
+    {
+        int dirty = 0;
+        for (int p = 0; p < np; p++)
+            if (reg[np - 1 - p][j] != parity[(long)p * ncw + j])
+                dirty = 1;
+        if (!dirty)
+            continue;
+
+        // Gather codeword j, padding positions past the data with zeros
+        for (long s = 0; s < rows; s++)
+            cw[s] = (s * ncw + j < len) ? data[s * ncw + j] : 0;
+        for (int p = 0; p < np; p++)
+            cw[rows + p] = parity[(long)p * ncw + j];
+
+        int n = fec_correct_codeword(fec, cw, rows + np);
+        if (n < 0)
+            return -1;
+
+        // A correction landing on a padding position means a miscorrection
+        for (long s = 0; s < rows; s++)
+        {
+            if (s * ncw + j < len)
+                data[s * ncw + j] = cw[s];
+            else if (cw[s] != 0)
+                return -1;
+        }
+        for (int p = 0; p < np; p++)
+            parity[(long)p * ncw + j] = cw[rows + p];
+        fixed += n;
+    }
+    return fixed;
+}
@@ -0,0 +1,51 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include "types.h"
+
+// Codeword length of RS(255, k) over GF(256)
+#define FEC_CODEWORD_LEN 255
+
+// Allowed range for the number of parity symbols per codeword
+#define FEC_MIN_PARITY 2
+#define FEC_MAX_PARITY 64
+
+// Number of codewords interleaved byte-by-byte in one group
+#define FEC_INTERLEAVE 16
+
+// Fixed size of the protected header (extn size + padded extn + file size)
+#define FEC_EXTN_MAX 8
+#define FEC_HEADER_SIZE (4 + FEC_EXTN_MAX + 4)
+
+/*
+ * Reed-Solomon codec state. A group is up to FEC_INTERLEAVE codewords
+ * whose data bytes are assigned round-robin, so the data of a group is
+ * stored unchanged and a burst of damaged bytes is spread over all of
+ * its codewords. Group parity follows the data, also round-robin.
+ */
+typedef struct _FecCodec
+{
+    int nparity;                    // Parity symbols per codeword
+    int data_per_cw;                // Data symbols per codeword
+    uchar gen[FEC_MAX_PARITY + 1];  // Generator polynomial, gen[0] is the constant term
+} FecCodec;
+
+// Function to initialise the codec for the given number of parity symbols
+Status fec_init(FecCodec *fec, int nparity);
+
+// Function to get the maximum data bytes carried by one interleaved group
+long fec_group_data_size(const FecCodec *fec);
+
+// Function to get the parity bytes added to a group carrying len data bytes
+long fec_group_parity_size(const FecCodec *fec, long len);
+
+// Function to get the total protected size of a len byte stream
+long fec_encoded_size(const FecCodec *fec, long len);
+
+// Function to compute the parity of one group of len data bytes
+Status fec_encode_group(const FecCodec *fec, const uchar *data, long len, uchar *parity);
+
+// Function to correct one group in place, returns corrected symbols or -1
+int fec_decode_group(const FecCodec *fec, uchar *data, long len, uchar *parity);
+
+#endif
@@ -12,15 +12,40 @@
                secure communication.
 */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "encode.h"
 #include "decode.h"
+#include "cipher.h"
+#include "fec.h"
+#include "planner.h"
 #include "types.h"
-// Function prototype to identify the operation type (-e or -d)
+
+// Optional settings that may follow the positional arguments
+typedef struct _Options
+{
+    int fec_parity;    // Parity symbols per FEC codeword (0 = FEC off)
+    char *key;         // Hex key or passphrase for encryption (NULL = off)
+    int passphrase;    // Whether key is a passphrase to stretch
+    uint raw_width;    // Width of raw RGB images (0 = not given)
+    uint raw_height;   // Height of raw RGB images (0 = not given)
+    char *index_fname; // Capacity cache used by --plan
+} Options;
+
+// Function prototype to identify the operation type (-e, -d or --plan)
 OperationType check_operation_type(char *);
 
+// Function prototype to strip options out of argv
+Status parse_options(int *argc, char *argv[], Options *opts);
+
 int main(int argc, char *argv[])
 {
+    Options opts;
+
+    // Remove options such as --fec so the positional checks below are unchanged
+    if (parse_options(&argc, argv, &opts) == e_failure)
+        return 1;
+
     // Check that the program has enough arguments for encoding or decoding
     if (argc >= 3)
     {
@@ -31,13 +56,19 @@ int main(int argc, char *argv[])
             if (argc < 4)
             {
                 printf("Usage:\n");
-                printf("For Encoding: ./a.out -e <input.bmp> <secret.txt/.c/.sh> [output.bmp]\n");
-                printf("For Decoding: ./a.out -d <stego.bmp> [output.txt]\n");
+                printf("For Encoding: ./a.out -e <input.bmp/.ppm/.pgm/.tif/.rgb> <secret.txt/.c/.sh> [output image] [--fec <parity>] [--key <hex key> | --passphrase <text>] [--geometry <width>x<height>]\n");
+                printf("For Decoding: ./a.out -d <stego image> [output.txt] [--key <hex key> | --passphrase <text>] [--geometry <width>x<height>]\n");
+                printf("For Planning: ./a.out --plan <carriers.lst> <secrets.lst> [plan.txt] [--fec <parity>] [--key <hex key> | --passphrase <text>] [--index <file>]\n");
                 return 1;
             }
 
             // Create structure to hold encoding-related information
             EncodeInfo encInfo;
+            encInfo.fec_parity = opts.fec_parity;
+            encInfo.key = opts.key;
+            encInfo.passphrase = opts.passphrase;
+            encInfo.raw_width = opts.raw_width;
+            encInfo.raw_height = opts.raw_height;
 
             // Validate encoding input arguments
             if (read_and_validate_encode_args(argv, &encInfo) == e_success)
@@ -59,6 +90,10 @@ int main(int argc, char *argv[])
         {
             // Create structure to hold decoding-related information
             DecodeInfo decInfo;
+            decInfo.key = opts.key;
+            decInfo.passphrase = opts.passphrase;
+            decInfo.raw_width = opts.raw_width;
+            decInfo.raw_height = opts.raw_height;
 
             // Validate and assign decoding arguments
             if (argv[2] != NULL)
@@ -81,10 +116,39 @@ int main(int argc, char *argv[])
             {
                 // Handle missing arguments for decoding
                 printf("ERROR: Missing arguments for decoding.\n");
-                printf("Usage: ./a.out -d <stego.bmp> [output.txt]\n");
+                printf("Usage: ./a.out -d <stego image> [output.txt] [--key <hex key> | --passphrase <text>] [--geometry <width>x<height>]\n");
                 return e_failure;
             }
         }
+        // If the operation selected is planning carriers for a batch of secrets
+        else if (check_operation_type(argv[1]) == e_plan)
+        {
+            if (argc < 4)
+            {
+                printf("ERROR: Missing arguments for planning.\n");
+                printf("Usage: ./a.out --plan <carriers.lst> <secrets.lst> [plan.txt] [--fec <parity>] [--key <hex key> | --passphrase <text>] [--index <file>]\n");
+                return e_failure;
+            }
+
+            // Create structure to hold planning-related information
+            PlanInfo planInfo;
+            planInfo.carrier_list_fname = argv[2];
+            planInfo.secret_list_fname = argv[3];
+            planInfo.plan_fname = argv[4] != NULL ? argv[4] : PLAN_DEFAULT_FNAME;
+            planInfo.index_fname = opts.index_fname != NULL ? opts.index_fname : PLAN_INDEX_FNAME;
+            planInfo.program = argv[0];
+            planInfo.fec_parity = opts.fec_parity;
+            planInfo.encrypted = opts.key != NULL;
+            planInfo.passphrase = opts.passphrase;
+            planInfo.raw_width = opts.raw_width;
+            planInfo.raw_height = opts.raw_height;
+
+            // Perform the planning
+            if (do_planning(&planInfo) == e_success)
+                printf("Planning Successful.\n");
+            else
+                printf("Planning Failed.\n");
+        }
         // Handle unsupported or invalid operation type
         else
         {
@@ -95,8 +159,9 @@ int main(int argc, char *argv[])
     {
         // Display correct usage instructions when insufficient arguments are given
         printf("Usage:\n");
-        printf("For Encoding: ./a.out -e <input.bmp> <secret.txt/.c/.sh> [output.bmp]\n");
-        printf("For Decoding: ./a.out -d <stego.bmp> [output.txt]\n");
+        printf("For Encoding: ./a.out -e <input.bmp/.ppm/.pgm/.tif/.rgb> <secret.txt/.c/.sh> [output image] [--fec <parity>] [--key <hex key> | --passphrase <text>] [--geometry <width>x<height>]\n");
+        printf("For Decoding: ./a.out -d <stego image> [output.txt] [--key <hex key> | --passphrase <text>] [--geometry <width>x<height>]\n");
+        printf("For Planning: ./a.out --plan <carriers.lst> <secrets.lst> [plan.txt] [--fec <parity>] [--key <hex key> | --passphrase <text>] [--index <file>]\n");
     }
     return 0;
 }
@@ -107,6 +172,83 @@ OperationType check_operation_type(char *symbol)
         return e_encode;      // Encoding mode
     else if (strcmp(symbol, "-d") == 0)
         return e_decode;      // Decoding mode
+    else if (strcmp(symbol, "--plan") == 0)
+        return e_plan;        // Planning mode
     else
         return e_unsupported; // Invalid operation
 }
+
+// Function to strip recognised options from argv and store them in opts
+Status parse_options(int *argc, char *argv[], Options *opts)
+{
+    int kept = 1;
+
+    opts->fec_parity = 0;
+    opts->key = NULL;
+    opts->passphrase = 0;
+    opts->raw_width = 0;
+    opts->raw_height = 0;
+    opts->index_fname = NULL;
+    for (int i = 1; i < *argc; i++)
+    {
+        if (strcmp(argv[i], "--fec") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                printf("ERROR: --fec needs the number of parity symbols per codeword\n");
+                return e_failure;
+            }
+            opts->fec_parity = atoi(argv[++i]);
+            if (opts->fec_parity < FEC_MIN_PARITY || opts->fec_parity > FEC_MAX_PARITY)
+            {
+                printf("ERROR: FEC parity must be between %d and %d\n", FEC_MIN_PARITY, FEC_MAX_PARITY);
+                return e_failure;
+            }
+        }
+        else if (strcmp(argv[i], "--key") == 0)
+        {
+            uchar key[CIPHER_KEY_SIZE];
+            if (i + 1 >= *argc || cipher_parse_key(argv[i + 1], key) == e_failure)
+            {
+                printf("ERROR: --key needs a 256-bit key as %d hex digits\n", 2 * CIPHER_KEY_SIZE);
+                return e_failure;
+            }
+            opts->key = argv[++i];
+            opts->passphrase = 0;
+        }
+        else if (strcmp(argv[i], "--passphrase") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                printf("ERROR: --passphrase needs a passphrase\n");
+                return e_failure;
+            }
+            opts->key = argv[++i];
+            opts->passphrase = 1;
+        }
+        else if (strcmp(argv[i], "--geometry") == 0)
+        {
+            if (i + 1 >= *argc || sscanf(argv[i + 1], "%ux%u", &opts->raw_width, &opts->raw_height) != 2 ||
+                opts->raw_width == 0 || opts->raw_height == 0)
+            {
+                printf("ERROR: --geometry needs the raw image size as <width>x<height>\n");
+                return e_failure;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--index") == 0)
+        {
+            if (i + 1 >= *argc)
+            {
+                printf("ERROR: --index needs the capacity index file name\n");
+                return e_failure;
+            }
+            opts->index_fname = argv[++i];
+        }
+        else
+            argv[kept++] = argv[i];
+    }
+    argv[kept] = NULL;
+    *argc = kept;
+    return e_success;
+}
@@ -0,0 +1,607 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "planner.h"
+#include "carrier.h"
+#include "encode.h"
+#include "types.h"
+
+// Secret sizes that record why a secret cannot be placed
+#define PLAN_SECRET_MISSING -1
+#define PLAN_SECRET_EXTN_TOO_LONG -2
+
+/* Cached capacity of one carrier, valid while its mtime and size match */
+typedef struct _IndexEntry
+{
+    char *path;
+    long mtime;
+    long size;
+    long capacity;
+} IndexEntry;
+
+/* Open-addressing hash table of cached capacities keyed by path */
+typedef struct _PlanIndex
+{
+    IndexEntry *entries;
+    long slots;        // Table size (power of two)
+    long used;         // Occupied slots
+    int dirty;         // Whether the table must be saved
+} PlanIndex;
+
+// Function to hash a path (FNV-1a)
+static unsigned long hash_path(const char *path)
+{
+    unsigned long hash = 14695981039346656037UL;
+    while (*path)
+        hash = (hash ^ (uchar)*path++) * 1099511628211UL;
+    return hash;
+}
+
+// Function to find the slot holding path, or the empty slot where it belongs
+static IndexEntry *index_slot(PlanIndex *index, const char *path)
+{
+    long i = hash_path(path) & (index->slots - 1);
+    while (index->entries[i].path != NULL && strcmp(index->entries[i].path, path) != 0)
+        i = (i + 1) & (index->slots - 1);
+    return &index->entries[i];
+}
+
+// Function to add or update a cached capacity
+static Status index_store(PlanIndex *index, const char *path, long mtime, long size, long capacity)
+{
+    // Keep the table at most half full
+    if (2 * (index->used + 1) > index->slots)
+    {
+        PlanIndex grown = {calloc(index->slots * 2, sizeof(IndexEntry)), index->slots * 2, 0, 1};
+        if (grown.entries == NULL)
+            return e_failure;
+        for (long i = 0; i < index->slots; i++)
+            if (index->entries[i].path != NULL)
+            {
+                *index_slot(&grown, index->entries[i].path) = index->entries[i];
+                grown.used++;
+            }
+        free(index->entries);
+        *index = grown;
+    }
+
+    IndexEntry *entry = index_slot(index, path);
+    if (entry->path == NULL)
+    {
+        entry->path = strdup(path);
+        if (entry->path == NULL)
+            return e_failure;
+        index->used++;
+    }
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->capacity = capacity;
+    index->dirty = 1;
+    return e_success;
+}
+
+// Function to load the capacity cache (a missing file is an empty cache)
+static Status index_load(PlanIndex *index, const char *fname)
+{
+    char *line = NULL;
+    size_t line_size = 0;
+    long capacity, mtime, size;
+    int path_start;
+
+    index->slots = 1024;
+    index->used = 0;
+    index->dirty = 0;
+    index->entries = calloc(index->slots, sizeof(IndexEntry));
+    if (index->entries == NULL)
+        return e_failure;
+
+    FILE *fptr = fopen(fname, "r");
+    if (fptr == NULL)
+        return e_success;
+
+    // Each line: capacity mtime size path
+    while (getline(&line, &line_size, fptr) != -1)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (sscanf(line, "%ld %ld %ld %n", &capacity, &mtime, &size, &path_start) == 3 && line[path_start])
+            index_store(index, line + path_start, mtime, size, capacity);
+    }
+    free(line);
+    fclose(fptr);
+    index->dirty = 0;
+    return e_success;
+}
+
+// Function to write the capacity cache back if anything changed
+static Status index_save(PlanIndex *index, const char *fname)
+{
+    char tmp_fname[1024];
+
+    if (!index->dirty)
+        return e_success;
+
+    // Write a temporary file first so an interrupted run keeps the old cache
+    snprintf(tmp_fname, sizeof(tmp_fname), "%s.tmp", fname);
+    FILE *fptr = fopen(tmp_fname, "w");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to write capacity index %s\n", tmp_fname);
+        return e_failure;
+    }
+    for (long i = 0; i < index->slots; i++)
+    {
+        IndexEntry *entry = &index->entries[i];
+        if (entry->path != NULL)
+            fprintf(fptr, "%ld %ld %ld %s\n", entry->capacity, entry->mtime, entry->size, entry->path);
+    }
+    fclose(fptr);
+    return rename(tmp_fname, fname) == 0 ? e_success : e_failure;
+}
+
+// Function to free the capacity cache
+static void index_free(PlanIndex *index)
+{
+    for (long i = 0; i < index->slots; i++)
+        free(index->entries[i].path);
+    free(index->entries);
+}
+
+// Function to free a list of paths read by read_list
+static void free_list(char **paths, long count)
+{
+    for (long i = 0; i < count; i++)
+        free(paths[i]);
+    free(paths);
+}
+
+// Function to read a list file with one path per line
+static Status read_list(const char *fname, char ***paths, long *count)
+{
+    char *line = NULL;
+    size_t line_size = 0;
+    long allocated = 0;
+
+    FILE *fptr = fopen(fname, "r");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open list file %s\n", fname);
+        return e_failure;
+    }
+
+    *paths = NULL;
+    *count = 0;
+    while (getline(&line, &line_size, fptr) != -1)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0')
+            continue;
+
+        if (*count == allocated)
+        {
+            allocated = allocated ? allocated * 2 : 64;
+            char **grown = realloc(*paths, allocated * sizeof(char *));
+            if (grown == NULL)
+                break;
+            *paths = grown;
+        }
+        if (((*paths)[*count] = strdup(line)) == NULL)
+            break;
+        (*count)++;
+    }
+    int failed = !feof(fptr);
+    free(line);
+    fclose(fptr);
+
+    // A list cut short would silently leave files out of the plan
+    if (failed)
+    {
+        fprintf(stderr, "ERROR: Unable to read all of list file %s\n", fname);
+        free_list(*paths, *count);
+        return e_failure;
+    }
+    return e_success;
+}
+
+// Function to read a carrier's capacity from its header only
+static long probe_capacity(PlanInfo *planInfo, const char *path)
+{
+    Carrier carrier;
+    long capacity = -1;
+
+    FILE *fptr = fopen(path, "rb");
+    if (fptr == NULL)
+        return -1;
+    if (carrier_open(&carrier, path, fptr, planInfo->raw_width, planInfo->raw_height) == e_success)
+    {
+        capacity = carrier_capacity(&carrier);
+        carrier_close(&carrier);
+    }
+    fclose(fptr);
+    return capacity;
+}
+
+/* Identity of a listed carrier file, so two spellings of one file are caught */
+typedef struct _FileId
+{
+    dev_t dev;
+    ino_t ino;
+    long order;        // Position in the carrier list
+} FileId;
+
+// Function to order file identities by device, inode and list position
+static int compare_file_id(const void *a, const void *b)
+{
+    const FileId *x = a, *y = b;
+    if (x->dev != y->dev)
+        return x->dev < y->dev ? -1 : 1;
+    if (x->ino != y->ino)
+        return x->ino < y->ino ? -1 : 1;
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+// Function to check whether a path names one of the listed carriers
+static int is_listed_carrier(const char *path, const FileId *ids, long nids)
+{
+    struct stat st;
+    FileId key;
+
+    if (stat(path, &st) != 0)
+        return 0;
+    key = (FileId){st.st_dev, st.st_ino, 0};
+    long lo = 0, hi = nids;
+    while (lo < hi)
+    {
+        long mid = (lo + hi) / 2;
+        if (ids[mid].dev < key.dev || (ids[mid].dev == key.dev && ids[mid].ino < key.ino))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < nids && ids[lo].dev == key.dev && ids[lo].ino == key.ino;
+}
+
+// Function to name the stego image next to the carrier: name.bmp -> name.stego.bmp
+static char *get_output_fname(const char *carrier)
+{
+    const char *extn = strrchr(carrier, '.');
+    char *output = malloc(strlen(carrier) + 8);
+
+    if (output != NULL)
+        sprintf(output, "%.*s.stego%s", (int)(extn - carrier), carrier, extn);
+    return output;
+}
+
+/*
+ * Function to collect carriers and their capacities, using the cache where
+ * valid. Plan commands run in parallel, so no two may touch the same file:
+ * a carrier listed twice (by any spelling) is used once, and a carrier whose
+ * stego image would overwrite another listed carrier is skipped.
+ */
+static Status load_carriers(PlanInfo *planInfo, PlanIndex *index)
+{
+    char **paths;
+    long count, nids = 0;
+    struct stat st;
+
+    if (read_list(planInfo->carrier_list_fname, &paths, &count) == e_failure)
+        return e_failure;
+
+    planInfo->carriers = malloc((count ? count : 1) * sizeof(PlanItem));
+    planInfo->ncarriers = 0;
+    FileId *ids = malloc((count ? count : 1) * sizeof(FileId));
+    char *skip = calloc(count ? count : 1, 1);
+    if (planInfo->carriers == NULL || ids == NULL || skip == NULL)
+    {
+        free_list(paths, count);
+        free(ids);
+        free(skip);
+        return e_failure;
+    }
+
+    for (long i = 0; i < count; i++)
+    {
+        if (carrier_codec_for_file(paths[i]) == NULL || stat(paths[i], &st) != 0)
+        {
+            printf("Skipping carrier %s (unsupported or missing)\n", paths[i]);
+            skip[i] = 1;
+            continue;
+        }
+        ids[nids++] = (FileId){st.st_dev, st.st_ino, i};
+    }
+
+    // After sorting, repeats of a file follow its first listing
+    qsort(ids, nids, sizeof(FileId), compare_file_id);
+    for (long j = 1, first = 0; j < nids; j++)
+    {
+        if (ids[j].dev != ids[first].dev || ids[j].ino != ids[first].ino)
+        {
+            first = j;
+            continue;
+        }
+        printf("Skipping carrier %s (same file as %s)\n", paths[ids[j].order], paths[ids[first].order]);
+        skip[ids[j].order] = 1;
+    }
+
+    for (long i = 0; i < count; i++)
+    {
+        const CarrierCodec *codec = carrier_codec_for_file(paths[i]);
+        long capacity = -1;
+        char *output = NULL;
+
+        if (skip[i])
+        {
+            free(paths[i]);
+            continue;
+        }
+
+        output = get_output_fname(paths[i]);
+        if (output == NULL)
+        {
+            free(paths[i]);
+            continue;
+        }
+        if (is_listed_carrier(output, ids, nids))
+        {
+            printf("Skipping carrier %s (its stego image %s is also a listed carrier)\n", paths[i], output);
+            free(output);
+            free(paths[i]);
+            continue;
+        }
+
+        // Raw RGB capacity depends on --geometry, so only header formats are cached
+        stat(paths[i], &st);
+        IndexEntry *entry = index_slot(index, paths[i]);
+        if (!codec->needs_geometry && entry->path != NULL &&
+            entry->mtime == (long)st.st_mtime && entry->size == (long)st.st_size)
+            capacity = entry->capacity;
+        else
+        {
+            capacity = probe_capacity(planInfo, paths[i]);
+            if (capacity > 0 && !codec->needs_geometry)
+                index_store(index, paths[i], st.st_mtime, st.st_size, capacity);
+        }
+
+        if (capacity <= 0)
+        {
+            printf("Skipping carrier %s (unreadable header)\n", paths[i]);
+            free(output);
+            free(paths[i]);
+            continue;
+        }
+        planInfo->carriers[planInfo->ncarriers++] = (PlanItem){paths[i], output, capacity, -1};
+    }
+    free(ids);
+    free(skip);
+    free(paths);
+    return e_success;
+}
+
+// Function to collect secrets and the image bytes each one needs
+static Status load_secrets(PlanInfo *planInfo)
+{
+    char **paths;
+    long count;
+    struct stat st;
+
+    if (read_list(planInfo->secret_list_fname, &paths, &count) == e_failure)
+        return e_failure;
+
+    planInfo->secrets = malloc((count ? count : 1) * sizeof(PlanItem));
+    if (planInfo->secrets == NULL)
+    {
+        free_list(paths, count);
+        return e_failure;
+    }
+    planInfo->nsecrets = count;
+    for (long i = 0; i < count; i++)
+    {
+        long required = PLAN_SECRET_MISSING;
+
+        // Same checks and size formula as the encoder, so planned encodes cannot fail
+        if (validate_secret_fname(paths[i]) == e_success && stat(paths[i], &st) == 0)
+        {
+            required = get_required_capacity(st.st_size, strlen(get_secret_extn(paths[i])),
+                                             planInfo->fec_parity, planInfo->encrypted);
+            if (required < 0)
+                required = PLAN_SECRET_EXTN_TOO_LONG;
+        }
+        planInfo->secrets[i] = (PlanItem){paths[i], NULL, required, -1};
+    }
+    free(paths);
+    return e_success;
+}
+
+// Function to order carriers by increasing capacity
+static int compare_capacity(const void *a, const void *b)
+{
+    long x = ((const PlanItem *)a)->size, y = ((const PlanItem *)b)->size;
+    return (x > y) - (x < y);
+}
+
+// Function to order secrets by decreasing size
+static int compare_required(const void *a, const void *b)
+{
+    return compare_capacity(b, a);
+}
+
+// Function to find the first unused carrier at or after i (union-find with path halving)
+static long next_free(long *next, long i)
+{
+    while (next[i] != i)
+    {
+        next[i] = next[next[i]];
+        i = next[i];
+    }
+    return i;
+}
+
+/*
+ * Function to pair secrets with carriers. The format holds one secret per
+ * carrier, so this is best-fit decreasing: the largest secret first, each
+ * into the smallest unused carrier that still fits it. Used carriers are
+ * skipped with a union-find "next free" array, so the solve is O(n log n).
+ */
+static long assign_secrets(PlanInfo *planInfo)
+{
+    long nc = planInfo->ncarriers;
+    long *next = malloc((nc + 1) * sizeof(long));
+    long placed = 0;
+
+    qsort(planInfo->carriers, nc, sizeof(PlanItem), compare_capacity);
+    qsort(planInfo->secrets, planInfo->nsecrets, sizeof(PlanItem), compare_required);
+
+    for (long i = 0; i <= nc; i++)
+        next[i] = i;
+
+    for (long s = 0; s < planInfo->nsecrets; s++)
+    {
+        long required = planInfo->secrets[s].size;
+        long lo = 0, hi = nc;
+
+        if (required < 0)
+            continue;
+
+        // First carrier with capacity strictly greater than required (as check_capacity)
+        while (lo < hi)
+        {
+            long mid = (lo + hi) / 2;
+            if (planInfo->carriers[mid].size > required)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+
+        long c = next_free(next, lo);
+        if (c == nc)
+            continue;
+
+        planInfo->secrets[s].match = c;
+        planInfo->carriers[c].match = s;
+        next[c] = c + 1;
+        placed++;
+    }
+    free(next);
+    return placed;
+}
+
+// Function to write a string quoted for the shell
+static void write_quoted(FILE *fptr, const char *str)
+{
+    fputc('\'', fptr);
+    for (; *str; str++)
+    {
+        if (*str == '\'')
+            fputs("'\\''", fptr);
+        else
+            fputc(*str, fptr);
+    }
+    fputc('\'', fptr);
+}
+
+// Function to write one encode command per line, runnable in any order
+static Status write_plan(PlanInfo *planInfo)
+{
+    FILE *fptr = fopen(planInfo->plan_fname, "w");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open plan file %s\n", planInfo->plan_fname);
+        return e_failure;
+    }
+
+    fprintf(fptr, "# Run in parallel with: xargs -d '\\n' -P <jobs> -n 1 sh -c < %s\n", planInfo->plan_fname);
+    for (long s = 0; s < planInfo->nsecrets; s++)
+    {
+        PlanItem *secret = &planInfo->secrets[s];
+        if (secret->match < 0)
+            continue;
+
+        const char *carrier = planInfo->carriers[secret->match].path;
+        const char *output = planInfo->carriers[secret->match].output;
+
+        write_quoted(fptr, planInfo->program);
+        fputs(" -e ", fptr);
+        write_quoted(fptr, carrier);
+        fputc(' ', fptr);
+        write_quoted(fptr, secret->path);
+        fputc(' ', fptr);
+        write_quoted(fptr, output);
+        if (planInfo->fec_parity)
+            fprintf(fptr, " --fec %d", planInfo->fec_parity);
+        if (planInfo->encrypted)
+            fputs(planInfo->passphrase ? " --passphrase \"$STEG_KEY\"" : " --key \"$STEG_KEY\"", fptr);
+        if (planInfo->raw_width)
+            fprintf(fptr, " --geometry %ux%u", planInfo->raw_width, planInfo->raw_height);
+        fputc('\n', fptr);
+    }
+
+    // Secrets that fit nowhere are listed as comments
+    for (long s = 0; s < planInfo->nsecrets; s++)
+    {
+        PlanItem *secret = &planInfo->secrets[s];
+        if (secret->match >= 0)
+            continue;
+        if (secret->size == PLAN_SECRET_EXTN_TOO_LONG)
+            fprintf(fptr, "# unplaced (extension too long for FEC header): %s\n", secret->path);
+        else if (secret->size < 0)
+            fprintf(fptr, "# unplaced (unsupported or missing): %s\n", secret->path);
+        else
+            fprintf(fptr, "# unplaced (needs more than %ld image bytes): %s\n", secret->size, secret->path);
+    }
+
+    fclose(fptr);
+    return e_success;
+}
+
+// Function to plan which carrier each secret goes into and write the plan
+Status do_planning(PlanInfo *planInfo)
+{
+    PlanIndex index;
+    Status status = e_failure;
+    clock_t start = clock();
+
+    planInfo->carriers = NULL;
+    planInfo->secrets = NULL;
+    planInfo->ncarriers = planInfo->nsecrets = 0;
+
+    printf("Loading capacity index %s\n", planInfo->index_fname);
+    if (index_load(&index, planInfo->index_fname) == e_failure)
+        return e_failure;
+
+    printf("Probing carrier capacities\n");
+    if (load_carriers(planInfo, &index) == e_success && load_secrets(planInfo) == e_success)
+    {
+        clock_t solve = clock();
+        long placed = assign_secrets(planInfo);
+        double solve_ms = 1000.0 * (clock() - solve) / CLOCKS_PER_SEC;
+
+        printf("Placed %ld of %ld secrets into %ld carriers (solve %.2f ms, total %.2f ms)\n",
+               placed, planInfo->nsecrets, planInfo->ncarriers, solve_ms,
+               1000.0 * (clock() - start) / CLOCKS_PER_SEC);
+
+        if (write_plan(planInfo) == e_success)
+        {
+            printf("Plan written to %s\n", planInfo->plan_fname);
+            if (planInfo->encrypted)
+                printf("Set STEG_KEY to the %s before running the plan\n", planInfo->passphrase ? "passphrase" : "hex key");
+            status = e_success;
+        }
+    }
+    index_save(&index, planInfo->index_fname);
+    index_free(&index);
+
+    for (long i = 0; i < planInfo->ncarriers; i++)
+    {
+        free(planInfo->carriers[i].path);
+        free(planInfo->carriers[i].output);
+    }
+    for (long i = 0; i < planInfo->nsecrets; i++)
+        free(planInfo->secrets[i].path);
+    free(planInfo->carriers);
+    free(planInfo->secrets);
+    return status;
+}
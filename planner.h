@@ -0,0 +1,46 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "types.h"
+
+// Default on-disk cache of carrier capacities
+#define PLAN_INDEX_FNAME ".steg_index"
+
+// Default plan file written by --plan
+#define PLAN_DEFAULT_FNAME "steg_plan.txt"
+
+/* A carrier or secret file taking part in the plan */
+typedef struct _PlanItem
+{
+    char *path;         // File name as listed
+    char *output;       // Stego image to write (carriers only)
+    long size;          // Capacity in image bytes (carrier) or bytes needed (secret)
+    long match;         // Index of the paired item, -1 if none
+} PlanItem;
+
+/*
+ * Structure to store information required for planning which carrier
+ * each secret file goes into before any encoding is run
+ */
+typedef struct _PlanInfo
+{
+    char *carrier_list_fname;  // File listing one carrier image per line
+    char *secret_list_fname;   // File listing one secret file per line
+    char *plan_fname;          // Plan file to write
+    char *index_fname;         // Capacity cache file
+    char *program;             // Program name used in the plan commands
+    int fec_parity;            // Parity symbols per FEC codeword (0 = FEC off)
+    int encrypted;             // Whether the secrets will be encrypted
+    int passphrase;            // Whether the key is a passphrase rather than a hex key
+    uint raw_width;            // Width of raw RGB carriers
+    uint raw_height;           // Height of raw RGB carriers
+    PlanItem *carriers;        // Carriers with known capacity
+    long ncarriers;
+    PlanItem *secrets;         // Secrets with known size
+    long nsecrets;
+} PlanInfo;
+
+// Function to plan which carrier each secret goes into and write the plan
+Status do_planning(PlanInfo *planInfo);
+
+#endif
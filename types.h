@@ -3,6 +3,7 @@
 
 /* User defined types */
 typedef unsigned int uint;
+typedef unsigned char uchar;
 
 /* Status will be used in fn. return type */
 typedef enum
@@ -15,6 +16,7 @@ typedef enum
 {
     e_encode,
     e_decode,
+    e_plan,
     e_unsupported
 } OperationType;
 